@@ -0,0 +1,135 @@
+// 把同一条消息发给很多连接(pub/sub扇出)的开销：
+//   copy:    对每个连接调用send(string_view)，每个连接拷贝一份，写不完的部分再拷贝到输出缓冲区
+//   payload: TcpServer::broadcast(Payload)，每个loop一个任务，所有连接引用同一份数据
+// 服务端有threads个io loop，客户端一个线程用poll读所有的连接，统计从开始发送到所有连接收完的时间。
+// copied是copy方式在服务端拷贝的字节数(每个连接一份)，payload方式不拷贝
+//
+// usage: broadcast_bench [conns] [messages] [message_kbytes] [threads]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/inet_address.h"
+#include "muduo/src/payload.h"
+#include "muduo/src/tcpserver.h"
+
+using namespace muduo;
+
+namespace {
+
+double now_ms() {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int connect_to(uint16_t port) {
+  int                sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0x00, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) != 0) {
+    perror("connect");
+    exit(1);
+  }
+  return sockfd;
+}
+
+// 每个连接读到bytes字节为止
+void read_all(const std::vector<int> &fds, size_t bytes) {
+  std::vector<struct pollfd> pfds;
+  for (int fd : fds) pfds.push_back({fd, POLLIN, 0});
+  std::vector<size_t> received(fds.size(), 0);
+  size_t              done = 0;
+  char                buf[ 65536 ];
+  while (done < fds.size()) {
+    ::poll(pfds.data(), pfds.size(), -1);
+    for (size_t i = 0; i < pfds.size(); ++i) {
+      if (!(pfds[ i ].revents & POLLIN)) continue;
+      ssize_t n = ::read(pfds[ i ].fd, buf, sizeof buf);
+      if (n <= 0) {
+        perror("read");
+        exit(1);
+      }
+      received[ i ] += static_cast<size_t>(n);
+      if (received[ i ] == bytes) {
+        pfds[ i ].events = 0;
+        ++done;
+      }
+    }
+  }
+}
+
+void bench(bool use_payload, int conns, int messages, size_t message_size, int threads, uint16_t port) {
+  EventLoop                                   loop;
+  TcpServer                                   server(&loop, InetAddress(port, true), "broadcast");
+  std::mutex                                  mutex;
+  std::vector<std::shared_ptr<TcpConnection>> connections;
+  server.set_thread_num(threads);
+  server.set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (conn->connected()) connections.push_back(conn);
+  });
+  server.start();
+
+  std::thread client([ & ] {
+    std::vector<int> fds;
+    for (int i = 0; i < conns; ++i) fds.push_back(connect_to(port));
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (connections.size() == static_cast<size_t>(conns)) break;
+      }
+      ::usleep(1000);
+    }
+    std::string message(message_size, 'm');
+    std::thread reader([ & ] { read_all(fds, message_size * messages); });
+    double      start = now_ms();
+    for (int i = 0; i < messages; ++i) {
+      if (use_payload) {
+        server.broadcast(Payload(message));
+      } else {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &conn : connections) conn->send(message);
+      }
+    }
+    reader.join();
+    double ms = now_ms() - start;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      connections.clear();
+    }
+    double mbytes = static_cast<double>(message_size) * messages * conns / (1 << 20);
+    printf("%-8s conns=%-6d messages=%-4d size=%-8zu threads=%-2d ms=%-9.1f MiB/s=%-9.1f copied=%.1fMiB\n",
+           use_payload ? "payload" : "copy", conns, messages, message_size, threads, ms, mbytes / (ms / 1000),
+           use_payload ? 0.0 : mbytes);
+    for (int fd : fds) ::close(fd);
+    loop.queue_in_loop([ &loop ] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int    conns = argc > 1 ? atoi(argv[ 1 ]) : 200;
+  int    messages = argc > 2 ? atoi(argv[ 2 ]) : 16;
+  size_t message_size = (argc > 3 ? static_cast<size_t>(atoi(argv[ 3 ])) : 64) * 1024;
+  int    threads = argc > 4 ? atoi(argv[ 4 ]) : 2;
+  bench(false, conns, messages, message_size, threads, 19961);
+  bench(true, conns, messages, message_size, threads, 19962);
+}
@@ -0,0 +1,132 @@
+// Buffer在64B、4KiB、1MiB消息下的开销
+//   append/retrieve: 追加一条消息再整条取走
+//   partial:         每次追加一条消息、取走一条半消息的前一部分，剩下的半条留在buffer中，触发挪动(compaction)
+//   read_fd:         从pipe读一条消息，对比readv+64KiB extrabuf和每次先留出kInitialSize再read(2)，
+//                    syscalls/msg是读完一条消息需要的系统调用次数
+//
+// usage: buffer_bench [total_mbytes]
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+
+#include "muduo/src/buffer.h"
+
+using namespace muduo;
+
+namespace {
+
+int64_t g_sink = 0;
+
+double now_ns() {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const char *name, size_t msg_size, int64_t messages, double ns, double syscalls = 0) {
+  double gbps = static_cast<double>(msg_size) * messages / ns;
+  if (syscalls > 0) {
+    printf("%-22s msg=%-8zu ns/msg=%-10.1f GB/s=%-7.2f syscalls/msg=%.2f\n", name, msg_size, ns / messages, gbps,
+           syscalls / messages);
+  } else {
+    printf("%-22s msg=%-8zu ns/msg=%-10.1f GB/s=%.2f\n", name, msg_size, ns / messages, gbps);
+  }
+}
+
+void bench_append_retrieve(const std::string &message, int64_t messages) {
+  Buffer buf;
+  double start = now_ns();
+  for (int64_t i = 0; i < messages; ++i) {
+    buf.append(message);
+    g_sink += buf.peek()[ message.size() - 1 ];
+    buf.retrieve(message.size());
+  }
+  report("append/retrieve", message.size(), messages, now_ns() - start);
+}
+
+// 每轮取走的比追加的少一点，可读数据始终只有半条，空间由前面读走的部分挪出来
+void bench_partial(const std::string &message, int64_t messages) {
+  Buffer       buf;
+  const size_t half = message.size() / 2;
+  buf.append(message.data(), half);
+  double start = now_ns();
+  for (int64_t i = 0; i < messages; ++i) {
+    buf.append(message);
+    g_sink += buf.peek()[ 0 ];
+    buf.retrieve(message.size());
+  }
+  report("partial", message.size(), messages, now_ns() - start);
+  g_sink += static_cast<int64_t>(buf.internal_capacity());
+}
+
+// 旧的做法：每次确保kInitialSize的可写空间，read到可写空间为止
+ssize_t read_fd_plain(Buffer *buf, int fd, int *saved_errno) {
+  buf->ensure_writable_bytes(Buffer::kInitialSize);
+  ssize_t n = ::read(fd, buf->begin_write(), buf->writable_bytes());
+  if (n < 0) {
+    *saved_errno = errno;
+  } else {
+    buf->has_written(static_cast<size_t>(n));
+  }
+  return n;
+}
+
+template <typename ReadFd>
+void bench_read_fd(const char *name, const std::string &message, int64_t messages, ReadFd &&read_fd) {
+  int fds[ 2 ];
+  if (::pipe2(fds, O_NONBLOCK) != 0) {
+    perror("pipe2");
+    exit(1);
+  }
+  // pipe的容量默认64KiB，尽量放得下一整条消息，失败时分多次写
+  ::fcntl(fds[ 1 ], F_SETPIPE_SZ, static_cast<int>(std::max<size_t>(message.size(), 65536)));
+  Buffer  buf;
+  int64_t syscalls = 0;
+  double  elapsed = 0;
+  for (int64_t i = 0; i < messages; ++i) {
+    size_t written = 0;
+    while (written < message.size()) {
+      ssize_t n = ::write(fds[ 1 ], message.data() + written, message.size() - written);
+      if (n <= 0) break;
+      written += static_cast<size_t>(n);
+      // 只统计读的时间
+      double start = now_ns();
+      while (buf.readable_bytes() < written) {
+        int saved_errno = 0;
+        ++syscalls;
+        if (read_fd(&buf, fds[ 0 ], &saved_errno) < 0 && saved_errno != EAGAIN) {
+          perror("read");
+          exit(1);
+        }
+      }
+      elapsed += now_ns() - start;
+    }
+    g_sink += buf.peek()[ 0 ];
+    buf.retrieve_all();
+  }
+  report(name, message.size(), messages, elapsed, static_cast<double>(syscalls));
+  ::close(fds[ 0 ]);
+  ::close(fds[ 1 ]);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int64_t total_bytes = (argc > 1 ? atoll(argv[ 1 ]) : 1024) * 1024 * 1024;
+  for (size_t msg_size : {size_t(64), size_t(4096), size_t(1024 * 1024)}) {
+    std::string message(msg_size, 'x');
+    int64_t     messages = std::max<int64_t>(total_bytes / static_cast<int64_t>(msg_size), 16);
+    // 走系统调用的部分数据量小一些
+    int64_t io_messages = std::max<int64_t>(messages / 16, 16);
+    bench_append_retrieve(message, messages);
+    bench_partial(message, messages);
+    bench_read_fd("read_fd(readv)", message, io_messages,
+                  [](Buffer *buf, int fd, int *saved_errno) { return buf->read_fd(fd, saved_errno); });
+    bench_read_fd("read_fd(plain read)", message, io_messages, read_fd_plain);
+  }
+  return g_sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+// 对比busy poll打开和关闭时，跨线程提交任务到任务被执行的延迟
+//
+// usage: busy_poll_bench [max_spin_us] [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_thread.h"
+
+using namespace muduo;
+
+namespace {
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+void run(int64_t max_spin_us, int rounds) {
+  EventLoopThread loop_thread(EventLoopThread::ThreadInitCallback(), "busy_poll_bench");
+  EventLoop      *loop = loop_thread.start_loop();
+  loop->set_busy_poll(max_spin_us);
+
+  std::vector<int64_t> latencies;
+  latencies.reserve(rounds);
+  for (int i = 0; i < rounds; ++i) {
+    std::atomic<int64_t> executed{0};
+    int64_t              submitted = now_ns();
+    loop->queue_in_loop([ &executed ] { executed = now_ns(); });
+    while (executed == 0) {
+    }
+    latencies.push_back(executed - submitted);
+    // 模拟请求之间的间隙
+    if (i % 16 == 0) ::usleep(100);
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  printf("max_spin_us=%-6ld p50=%-8ldns p99=%-8ldns max=%-10ldns spin_hits=%ld spin_misses=%ld budget_us=%ld\n",
+         max_spin_us, latencies[ latencies.size() / 2 ], latencies[ latencies.size() * 99 / 100 ], latencies.back(),
+         loop->busy_poll_hits(), loop->busy_poll_misses(), loop->busy_poll_budget_us());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int64_t max_spin_us = argc > 1 ? atol(argv[ 1 ]) : 50;
+  int     rounds = argc > 2 ? atoi(argv[ 2 ]) : 100000;
+  run(0, rounds);
+  run(max_spin_us, rounds);
+}
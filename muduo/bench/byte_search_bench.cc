@@ -0,0 +1,161 @@
+// Buffer中查找分隔符的开销
+//   scan:        64B、4KiB、1MiB的数据，分隔符在最后，对比std::search/std::find/memchr和byte_search各级别的实现
+//   lines:       每行32B、256B的数据，逐行查找所有的"\r\n"，分隔符很密时每次调用的固定开销占主要部分
+//   binary:      64KiB随机数据(比如RESP的bulk string)，最后是"\r\n"，单独的'\r'平均每256字节出现一次，
+//                memchr('\r')每次命中都要返回再重新开始
+//   incremental: 一条1MiB的消息每次到达4KiB，每次到达后查找"\r\n"，
+//                对比每次从peek()开始查找和Buffer::find_crlf()从上次停下的地方继续
+//
+// usage: byte_search_bench [total_mbytes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "muduo/src/buffer.h"
+#include "muduo/src/byte_search.h"
+
+using namespace muduo;
+
+namespace {
+
+int64_t g_sink = 0;
+
+double now_ns() {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const char *name, const char *kernel, size_t size, int64_t rounds, double ns) {
+  printf("%-12s %-12s size=%-8zu ns/round=%-10.1f GB/s=%.2f\n", name, kernel, size, ns / rounds,
+         static_cast<double>(size) * rounds / ns);
+}
+
+const char *crlf_std_search(const char *begin, const char *end) {
+  const char *crlf = std::search(begin, end, "\r\n", "\r\n" + 2);
+  return crlf == end ? nullptr : crlf;
+}
+
+const char *byte_std_find(const char *begin, const char *end, char c) {
+  const char *p = std::find(begin, end, c);
+  return p == end ? nullptr : p;
+}
+
+const char *byte_memchr(const char *begin, const char *end, char c) {
+  return static_cast<const char *>(::memchr(begin, c, end - begin));
+}
+
+template <typename Find>
+void bench_scan(const char *name, const char *kernel, const std::string &data, int64_t rounds, Find &&find) {
+  const char *begin = data.data();
+  const char *end = begin + data.size();
+  double      start = now_ns();
+  for (int64_t i = 0; i < rounds; ++i) {
+    // 防止编译器把循环提出去
+    asm volatile("" : : "r"(begin) : "memory");
+    g_sink += find(begin, end) - begin;
+  }
+  report(name, kernel, data.size(), rounds, now_ns() - start);
+}
+
+template <typename FindCrlf>
+void bench_lines(const char *kernel, const std::string &data, size_t line_size, int64_t rounds, FindCrlf &&find_crlf) {
+  const char *end = data.data() + data.size();
+  double      start = now_ns();
+  for (int64_t i = 0; i < rounds; ++i) {
+    asm volatile("" : : : "memory");
+    for (const char *p = data.data(); const char *crlf = find_crlf(p, end); p = crlf + 2) ++g_sink;
+  }
+  char name[ 32 ];
+  snprintf(name, sizeof name, "lines(%zu)", line_size);
+  report(name, kernel, data.size(), rounds, now_ns() - start);
+}
+
+const size_t kMessageSize = 1024 * 1024;
+const size_t kPieceSize = 4096;
+
+// resume为false时每次从peek()开始，查找的总字节数是消息大小的平方级
+void bench_incremental(const char *name, int64_t rounds, bool resume) {
+  std::string piece(kPieceSize, 'x');
+  Buffer      buf;
+  double      start = now_ns();
+  for (int64_t i = 0; i < rounds; ++i) {
+    for (size_t received = 0; received < kMessageSize; received += kPieceSize) {
+      buf.append(piece);
+      if (received + kPieceSize == kMessageSize) {
+        // 消息最后是"\r\n"
+        buf.unwrite(2);
+        buf.append("\r\n", 2);
+      }
+      const char *crlf = resume ? buf.find_crlf() : buf.find_crlf(buf.peek());
+      if (crlf) g_sink += crlf - buf.peek();
+    }
+    buf.retrieve_all();
+  }
+  report("incremental", name, kMessageSize, rounds, now_ns() - start);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int64_t total_bytes = (argc > 1 ? atoll(argv[ 1 ]) : 1024) * 1024 * 1024;
+  printf("active kernel: %s\n", byte_search::active().name);
+  for (size_t size : {size_t(64), size_t(4096), size_t(1024 * 1024)}) {
+    std::string data(size, 'x');
+    data[ size - 2 ] = '\r';
+    data[ size - 1 ] = '\n';
+    int64_t rounds = std::max<int64_t>(total_bytes / static_cast<int64_t>(size), 16);
+    bench_scan("crlf", "std::search", data, rounds, crlf_std_search);
+    for (int level = byte_search::kScalar; level <= byte_search::kAvx2; ++level) {
+      if (const byte_search::Kernels *k = byte_search::kernels(static_cast<byte_search::Level>(level))) {
+        bench_scan("crlf", k->name, data, rounds, k->find_crlf);
+      }
+    }
+    auto eol = [](byte_search::FindByte find) {
+      return [ find ](const char *begin, const char *end) { return find(begin, end, '\n'); };
+    };
+    bench_scan("eol", "std::find", data, rounds, eol(byte_std_find));
+    bench_scan("eol", "memchr", data, rounds, eol(byte_memchr));
+    for (int level = byte_search::kSse2; level <= byte_search::kAvx2; ++level) {
+      if (const byte_search::Kernels *k = byte_search::kernels(static_cast<byte_search::Level>(level))) {
+        bench_scan("eol", k->name, data, rounds, eol(k->find_byte));
+      }
+    }
+  }
+
+  for (size_t line_size : {size_t(32), size_t(256)}) {
+    std::string data;
+    while (data.size() < 64 * 1024) data += std::string(line_size - 2, 'x') + "\r\n";
+    int64_t rounds = std::max<int64_t>(total_bytes / static_cast<int64_t>(data.size()), 16);
+    bench_lines("std::search", data, line_size, rounds, crlf_std_search);
+    for (int level = byte_search::kScalar; level <= byte_search::kAvx2; ++level) {
+      if (const byte_search::Kernels *k = byte_search::kernels(static_cast<byte_search::Level>(level))) {
+        bench_lines(k->name, data, line_size, rounds, k->find_crlf);
+      }
+    }
+  }
+
+  std::string binary(64 * 1024, '\0');
+  srand(1);
+  for (char &c : binary) {
+    c = static_cast<char>(rand());
+    if (c == '\n') c = 'x';
+  }
+  binary[ binary.size() - 1 ] = '\n';
+  binary[ binary.size() - 2 ] = '\r';
+  int64_t binary_rounds = std::max<int64_t>(total_bytes / static_cast<int64_t>(binary.size()), 16);
+  bench_scan("binary", "std::search", binary, binary_rounds, crlf_std_search);
+  for (int level = byte_search::kScalar; level <= byte_search::kAvx2; ++level) {
+    if (const byte_search::Kernels *k = byte_search::kernels(static_cast<byte_search::Level>(level))) {
+      bench_scan("binary", k->name, binary, binary_rounds, k->find_crlf);
+    }
+  }
+
+  int64_t rounds = std::max<int64_t>(total_bytes / static_cast<int64_t>(kMessageSize) / 64, 4);
+  bench_incremental("rescan", rounds, false);
+  bench_incremental("resume", rounds, true);
+  return g_sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+// 大量Channel反复enable_writing/disable_writing时Poller::update_channel的耗时
+//
+// 每个Channel对应一个eventfd，先全部enable_reading，然后每一轮对所有Channel各做一次enable_writing和disable_writing，
+// epoll下每次都是一次EPOLL_CTL_MOD加上_channels的查找，io_uring下只填SQE，查找的开销占比更大。
+// 另外单独对比std::map<int, Channel *>和ChannelMap按fd查找的耗时，作为Poller中fd到Channel映射本身的开销。
+//
+// usage: channel_toggle_bench [channels] [rounds]
+// channels超过RLIMIT_NOFILE的硬限制时按硬限制减去预留的fd数运行
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "muduo/src/channel.h"
+#include "muduo/src/channel_map.h"
+#include "muduo/src/event_loop.h"
+
+using namespace muduo;
+
+namespace {
+
+const int kReservedFds = 64;
+
+double elapsed_ns(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int raise_fd_limit(int wanted) {
+  struct rlimit rl;
+  ::getrlimit(RLIMIT_NOFILE, &rl);
+  rlim_t need = static_cast<rlim_t>(wanted) + kReservedFds;
+  rl.rlim_cur = rl.rlim_max == RLIM_INFINITY ? need : std::min(need, rl.rlim_max);
+  ::setrlimit(RLIMIT_NOFILE, &rl);
+  ::getrlimit(RLIMIT_NOFILE, &rl);
+  return static_cast<int>(std::min<rlim_t>(static_cast<rlim_t>(wanted), rl.rlim_cur - kReservedFds));
+}
+
+void toggle(PollerBackend backend, int channels, int rounds) {
+  EventLoop                             loop(backend);
+  std::vector<std::unique_ptr<Channel>> chs;
+  chs.reserve(channels);
+  for (int i = 0; i < channels; ++i) {
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+      perror("eventfd");
+      exit(1);
+    }
+    chs.emplace_back(new Channel(&loop, fd));
+    chs.back()->enable_reading();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (auto &ch : chs) {
+      ch->enable_writing();
+      ch->disable_writing();
+    }
+  }
+  double ns = elapsed_ns(start);
+  printf("poller=%-8s channels=%-7d ns/update=%.1f\n", loop.poller_name(), channels,
+         ns / (2.0 * channels * rounds));
+
+  for (auto &ch : chs) {
+    ch->disable_all();
+    ch->remove();
+    ::close(ch->fd());
+  }
+}
+
+// 按随机顺序查找，和大量连接上事件到来的顺序类似
+void lookup(int channels, int rounds) {
+  std::vector<int> fds(channels);
+  for (int i = 0; i < channels; ++i) fds[ i ] = i + 3;
+  std::shuffle(fds.begin(), fds.end(), std::mt19937(42));
+  Channel *dummy = reinterpret_cast<Channel *>(uintptr_t(0x1000));
+
+  std::map<int, Channel *> tree;
+  ChannelMap               flat;
+  for (int fd : fds) {
+    tree[ fd ] = dummy;
+    flat.insert(fd, dummy);
+  }
+
+  uintptr_t sink = 0;
+  auto      start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (int fd : fds) sink += reinterpret_cast<uintptr_t>(tree.find(fd)->second);
+  }
+  double tree_ns = elapsed_ns(start);
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (int fd : fds) sink += reinterpret_cast<uintptr_t>(flat.find(fd));
+  }
+  double flat_ns = elapsed_ns(start);
+  printf("lookup   channels=%-7d std::map ns/find=%.1f ChannelMap ns/find=%.1f (sink=%lu)\n", channels,
+         tree_ns / (1.0 * channels * rounds), flat_ns / (1.0 * channels * rounds), static_cast<unsigned long>(sink));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int wanted = argc > 1 ? atoi(argv[ 1 ]) : 100000;
+  int rounds = argc > 2 ? atoi(argv[ 2 ]) : 10;
+
+  int channels = raise_fd_limit(wanted);
+  if (channels < wanted) {
+    printf("RLIMIT_NOFILE allows only %d channels, wanted %d\n", channels, wanted);
+  }
+  lookup(wanted, rounds);
+  for (PollerBackend backend : {PollerBackend::kEpoll, PollerBackend::kIoUring}) {
+    toggle(backend, channels, rounds);
+  }
+}
@@ -0,0 +1,64 @@
+// 对比几种取当前时间的方式每次调用的耗时
+// 1. Timestamp::now()，gettimeofday(vdso)
+// 2. Timestamp::now_coarse()，CLOCK_REALTIME_COARSE
+// 3. monotonic_ns()，CLOCK_MONOTONIC
+// 4. EventLoop::now()，在loop线程中读取poll返回时缓存的时间
+// 5. rdtsc，仅作为参考的下限，x86以外的平台跳过
+//
+// usage: clock_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <future>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_thread.h"
+#include "muduo/src/loop_stats.h"
+#include "muduo/src/timestamp.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace muduo;
+
+namespace {
+
+uint64_t g_sink = 0;
+
+template <typename Func>
+void measure(const char *name, int iterations, Func &&func) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    g_sink += func();
+  }
+  auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  printf("%-28s ns/call=%.2f\n", name, ns / iterations);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? atoi(argv[ 1 ]) : 10000000;
+
+  measure("Timestamp::now", iterations, [] { return Timestamp::now().ms_since_epoch(); });
+  measure("Timestamp::now_coarse", iterations, [] { return Timestamp::now_coarse().ms_since_epoch(); });
+  measure("monotonic_ns", iterations, [] { return static_cast<uint64_t>(monotonic_ns()); });
+
+  EventLoopThread    loop_thread(EventLoopThread::ThreadInitCallback(), "clock_bench");
+  EventLoop         *loop = loop_thread.start_loop();
+  std::promise<void> done;
+  loop->run_in_loop([ & ] {
+    measure("EventLoop::now (in loop)", iterations, [ loop ] { return loop->now().ms_since_epoch(); });
+    done.set_value();
+  });
+  done.get_future().wait();
+  measure("EventLoop::now (other thread)", iterations, [ loop ] { return loop->now().ms_since_epoch(); });
+
+#if defined(__x86_64__) || defined(__i386__)
+  measure("rdtsc", iterations, [] { return static_cast<uint64_t>(__rdtsc()); });
+#endif
+  printf("sink=%lu\n", g_sink);
+}
@@ -0,0 +1,143 @@
+// 对比epoll和io_uring两种Poller在大量连接下每个事件的poller系统调用次数和吞吐
+//
+// 一个loop上有conns对socketpair，服务端一侧把读到的数据原样写回，客户端一侧收到回显后立即发送下一条，
+// 每对连接上始终有一条消息在途。read/write的次数两种poller相同，只统计poller自己的系统调用。
+// via_writable=1时服务端不直接写回，而是像输出缓冲区没写完时那样先关注可写事件，可写时再写并取消关注，
+// 每条消息要修改两次关注的事件，epoll需要两次epoll_ctl，io_uring合并到下一次io_uring_enter中。
+//
+// usage: echo_bench [conns] [seconds] [message_size] [via_writable]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "muduo/src/channel.h"
+#include "muduo/src/event_loop.h"
+
+using namespace muduo;
+
+namespace {
+
+struct Pair {
+  int                      fds[ 2 ]; // fds[0]为服务端，fds[1]为客户端
+  std::unique_ptr<Channel> server;
+  std::unique_ptr<Channel> client;
+  std::string              pending; // via_writable模式下服务端待写回的数据
+};
+
+struct Result {
+  const char *poller;
+  int64_t     messages;
+  int64_t     events;
+  int64_t     syscalls;
+  int64_t     iterations;
+};
+
+void run(PollerBackend backend, int conns, double seconds, size_t message_size, bool via_writable, Result *result) {
+  EventLoop         loop(backend);
+  std::vector<Pair> pairs(conns);
+  std::string       message(message_size, 'x');
+  int64_t           messages = 0;
+  int64_t           events = 0;
+
+  for (auto &pair : pairs) {
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair.fds) != 0) {
+      perror("socketpair");
+      exit(1);
+    }
+    int      server_fd = pair.fds[ 0 ];
+    int      client_fd = pair.fds[ 1 ];
+    Pair    *p = &pair;
+    Channel *server = new Channel(&loop, server_fd);
+    pair.server.reset(server);
+    server->set_read_callback([ server_fd, p, server, via_writable, &events ](Timestamp) {
+      char    buf[ 4096 ];
+      ssize_t n = ::read(server_fd, buf, sizeof buf);
+      if (n > 0) {
+        if (via_writable) {
+          p->pending.append(buf, n);
+          if (!server->is_writing()) server->enable_writing();
+        } else {
+          ssize_t w = ::write(server_fd, buf, n);
+          (void)w;
+        }
+      }
+      ++events;
+    });
+    server->set_write_callback([ server_fd, p, server, &events ] {
+      ssize_t w = ::write(server_fd, p->pending.data(), p->pending.size());
+      if (w > 0) p->pending.erase(0, w);
+      if (p->pending.empty()) server->disable_writing();
+      ++events;
+    });
+    pair.server->enable_reading();
+    pair.client.reset(new Channel(&loop, client_fd));
+    pair.client->set_read_callback([ client_fd, &message, &messages, &events ](Timestamp) {
+      char    buf[ 4096 ];
+      ssize_t n = ::read(client_fd, buf, sizeof buf);
+      if (n > 0) {
+        ++messages;
+        ssize_t w = ::write(client_fd, message.data(), message.size());
+        (void)w;
+      }
+      ++events;
+    });
+    pair.client->enable_reading();
+  }
+
+  loop.run_after(0.01, [ & ] {
+    for (auto &pair : pairs) {
+      ssize_t w = ::write(pair.fds[ 1 ], message.data(), message.size());
+      (void)w;
+    }
+  });
+  loop.run_after(0.01 + seconds, [ &loop ] { loop.quit(); });
+
+  int64_t syscalls_before = 0;
+  int64_t iterations_before = 0;
+  loop.run_after(0.01, [ & ] {
+    syscalls_before = loop.poller_syscalls();
+    iterations_before = loop.iteration();
+  });
+  loop.loop();
+
+  result->poller = loop.poller_name();
+  result->messages = messages;
+  result->events = events;
+  result->syscalls = loop.poller_syscalls() - syscalls_before;
+  result->iterations = loop.iteration() - iterations_before;
+
+  for (auto &pair : pairs) {
+    pair.server->disable_all();
+    pair.server->remove();
+    pair.client->disable_all();
+    pair.client->remove();
+    ::close(pair.fds[ 0 ]);
+    ::close(pair.fds[ 1 ]);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int    conns = argc > 1 ? atoi(argv[ 1 ]) : 1000;
+  double seconds = argc > 2 ? atof(argv[ 2 ]) : 5;
+  size_t message_size = argc > 3 ? static_cast<size_t>(atoi(argv[ 3 ])) : 64;
+  bool   via_writable = argc > 4 ? atoi(argv[ 4 ]) != 0 : false;
+
+  for (PollerBackend backend : {PollerBackend::kEpoll, PollerBackend::kIoUring}) {
+    Result      result;
+    std::thread thread(run, backend, conns, seconds, message_size, via_writable, &result);
+    thread.join();
+    printf("poller=%-8s conns=%-6d msgs/s=%-10.0f events/iteration=%-8.1f poller_syscalls/event=%.4f\n",
+           result.poller, conns, static_cast<double>(result.messages) / seconds,
+           static_cast<double>(result.events) / static_cast<double>(result.iterations ? result.iterations : 1),
+           static_cast<double>(result.syscalls) / static_cast<double>(result.events ? result.events : 1));
+  }
+}
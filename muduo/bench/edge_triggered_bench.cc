@@ -0,0 +1,138 @@
+// 对比TcpServer在水平触发和边沿触发下的epoll_ctl次数和吞吐
+//
+// 单个loop的服务器，客户端每发来一个8字节的请求，服务端回复response_kb大小的响应，
+// 客户端读完整个响应再发下一个请求。响应比socket发送缓冲区(默认最多自动增长到4MB，见tcp_wmem)大，
+// 服务端的write总是写不完，输出缓冲区在空和非空之间反复切换：
+// 水平触发时每个响应都要enable_writing/disable_writing，各一次epoll_ctl(MOD)；
+// 边沿触发时可写事件一直关注着，只在建立和断开连接时调用epoll_ctl。
+// 服务端loop每轮正好一次epoll_wait，epoll_ctl次数 = poller系统调用次数 - 轮数。
+//
+// usage: edge_triggered_bench [conns] [seconds] [response_kb]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/inet_address.h"
+#include "muduo/src/tcpserver.h"
+
+using namespace muduo;
+
+namespace {
+
+const size_t kRequestSize = 8;
+const int    kClientRcvBuf = 64 * 1024;
+
+int connect_to(uint16_t port) {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  int rcvbuf = kClientRcvBuf;
+  ::setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+  struct sockaddr_in addr;
+  memset(&addr, 0x00, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) != 0) {
+    perror("connect");
+    exit(1);
+  }
+  return sockfd;
+}
+
+// 发请求、读完响应，直到stop；返回收到的响应数
+void client(uint16_t port, size_t response_size, const std::atomic<bool> *stop, std::atomic<int64_t> *responses) {
+  int  sockfd = connect_to(port);
+  char request[ kRequestSize ] = {0};
+  char buf[ 65536 ];
+  while (!*stop) {
+    if (::write(sockfd, request, sizeof request) != static_cast<ssize_t>(sizeof request)) break;
+    size_t received = 0;
+    while (received < response_size) {
+      ssize_t n = ::read(sockfd, buf, sizeof buf);
+      if (n <= 0) break;
+      received += n;
+    }
+    if (received < response_size) break;
+    ++*responses;
+  }
+  ::close(sockfd);
+}
+
+void run(bool edge_triggered, int conns, double seconds, size_t response_size, uint16_t port) {
+  ::setenv("MUDUO_POLLER", "epoll", 1);
+  EventLoop   loop;
+  TcpServer   server(&loop, InetAddress(port, true), "bench");
+  std::string response(response_size, 'x');
+  int         down = 0;
+  server.set_edge_triggered(edge_triggered);
+  server.set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+    // 客户端全部断开、连接都销毁之后再退出loop
+    if (!conn->connected() && ++down == conns) loop.queue_in_loop([ &loop ] { loop.quit(); });
+  });
+  server.set_message_callback([ &response ](const std::shared_ptr<TcpConnection> &conn, Buffer *buf, Timestamp) {
+    while (buf->readable_bytes() >= kRequestSize) {
+      buf->retrieve(kRequestSize);
+      conn->send(response);
+    }
+  });
+  server.start();
+
+  std::atomic<bool>        stop{false};
+  std::atomic<int64_t>     responses{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < conns; ++i) {
+    threads.emplace_back(client, port, response_size, &stop, &responses);
+  }
+
+  int64_t syscalls_before = 0;
+  int64_t iterations_before = 0;
+  int64_t responses_before = 0;
+  int64_t syscalls = 0;
+  int64_t iterations = 0;
+  int64_t count = 0;
+  // 等所有连接都建立之后再开始统计
+  loop.run_after(0.2, [ & ] {
+    syscalls_before = loop.poller_syscalls();
+    iterations_before = loop.iteration();
+    responses_before = responses;
+  });
+  loop.run_after(0.2 + seconds, [ & ] {
+    syscalls = loop.poller_syscalls() - syscalls_before;
+    iterations = loop.iteration() - iterations_before;
+    count = responses - responses_before;
+    stop = true;
+  });
+  loop.loop();
+  for (auto &t : threads) t.join();
+
+  int64_t ctl = syscalls - iterations;
+  double  mib = static_cast<double>(count) * static_cast<double>(response_size) / (1 << 20);
+  printf("mode=%-15s conns=%-4d MiB/s=%-9.1f responses/s=%-9.0f epoll_ctl/s=%-9.0f epoll_wait/s=%-9.0f "
+         "epoll_ctl/response=%.2f\n",
+         edge_triggered ? "edge-triggered" : "level-triggered", conns, mib / seconds, count / seconds,
+         ctl / seconds, iterations / seconds, count ? static_cast<double>(ctl) / count : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int    conns = argc > 1 ? atoi(argv[ 1 ]) : 4;
+  double seconds = argc > 2 ? atof(argv[ 2 ]) : 3;
+  size_t response_size = static_cast<size_t>(argc > 3 ? atoi(argv[ 3 ]) : 16384) * 1024;
+  // 结束时客户端先关闭，服务端还可能在写
+  ::signal(SIGPIPE, SIG_IGN);
+
+  run(false, conns, seconds, response_size, 19991);
+  run(true, conns, seconds, response_size, 19992);
+}
@@ -0,0 +1,143 @@
+// 统计典型lambda在std::function和InlineFunction下每次提交的堆分配次数与耗时
+//
+// usage: functor_alloc_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <new>
+
+#include "muduo/src/callbacks.h"
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_thread.h"
+#include "muduo/src/inline_function.h"
+#include "muduo/src/mpsc_queue.h"
+
+using namespace muduo;
+
+namespace {
+std::atomic<int64_t> g_allocs{0};
+} // namespace
+
+void *operator new(size_t size) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = malloc(size)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+namespace {
+
+struct Connection {
+  int64_t bytes = 0;
+};
+
+int64_t g_sink = 0;
+
+template <typename Func>
+void measure(const char *name, int iterations, Func &&func) {
+  auto    start = std::chrono::steady_clock::now();
+  int64_t allocs = g_allocs.load();
+  for (int i = 0; i < iterations; ++i) {
+    func(i);
+  }
+  allocs = g_allocs.load() - allocs;
+  auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  printf("%-42s allocs/op=%.3f ns/op=%.1f\n", name, static_cast<double>(allocs) / iterations, ns / iterations);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? atoi(argv[ 1 ]) : 1000000;
+
+  // 典型的lambda：捕获一个shared_ptr、一个裸指针和两个整数，共40字节
+  auto conn = std::make_shared<Connection>();
+  auto make_task = [ &conn ](int i) {
+    Connection *raw = conn.get();
+    int64_t     a = i, b = i * 2;
+    return [ conn, raw, a, b ] {
+      raw->bytes += a + b;
+      g_sink += conn.use_count();
+    };
+  };
+  printf("lambda size=%zu, std::function size=%zu, Functor size=%zu\n", sizeof(make_task(0)),
+         sizeof(std::function<void()>), sizeof(Functor));
+
+  measure("std::function construct+call", iterations, [ & ](int i) {
+    std::function<void()> f(make_task(i));
+    f();
+  });
+  measure("Functor construct+call", iterations, [ & ](int i) {
+    Functor f(make_task(i));
+    f();
+  });
+
+  {
+    EventLoop loop;
+    // 在loop线程中，run_in_loop直接调用
+    measure("EventLoop::run_in_loop (in loop thread)", iterations, [ & ](int i) { loop.run_in_loop(make_task(i)); });
+  }
+
+  // 跨线程提交：节点从空闲缓存中复用，预热之后没有分配(统计包括loop线程)
+  // 每次提交kInFlight个再等它们执行完，节点总数由同时在队列中的个数决定，预热之后不再增长
+  {
+    const int        kInFlight = 1024;
+    EventLoopThread  loop_thread(EventLoopThread::ThreadInitCallback(), "functor_alloc");
+    EventLoop       *loop = loop_thread.start_loop();
+    std::atomic<int> done{0};
+    auto             submit_all = [ & ](int i) {
+      loop->run_in_loop([ task = make_task(i), &done ] {
+        task();
+        ++done;
+      });
+    };
+    auto run_rounds = [ & ] {
+      for (int i = 0; i < iterations; i += kInFlight) {
+        int n = std::min(kInFlight, iterations - i);
+        for (int j = 0; j < n; ++j) submit_all(i + j);
+        while (done != n) ::usleep(10);
+        done = 0;
+      }
+    };
+    // loop线程缓存中还没攒够一串的节点数每轮不同，节点总数要多轮才稳定
+    for (int warmup = 0; warmup < 10; ++warmup) {
+      int64_t before = g_allocs.load();
+      run_rounds();
+      if (g_allocs.load() == before) break;
+    }
+    auto    start = std::chrono::steady_clock::now();
+    int64_t allocs = g_allocs.load();
+    run_rounds();
+    allocs = g_allocs.load() - allocs;
+    auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%-42s allocs/op=%.3f ns/op=%.1f (total allocs=%ld)\n", "EventLoop::run_in_loop (cross thread)",
+           static_cast<double>(allocs) / iterations, ns / iterations, allocs);
+  }
+
+  // 队列本身：push和drain在同一个线程中，节点在线程的缓存中循环使用
+  {
+    MpscQueue<std::function<void()>> queue;
+    measure("MpscQueue<std::function> push+drain", iterations, [ & ](int i) {
+      queue.push(make_task(i));
+      auto batch = queue.take_all();
+      batch.front()();
+    });
+  }
+  {
+    MpscQueue<Functor> queue;
+    measure("MpscQueue<Functor> push+drain", iterations, [ & ](int i) {
+      queue.push(make_task(i));
+      auto batch = queue.take_all();
+      batch.front()();
+    });
+  }
+  printf("sink=%ld bytes=%ld\n", g_sink, conn->bytes);
+}
@@ -0,0 +1,138 @@
+// 输出缓冲区：单个连续的Buffer和OutputChain(writev)在大小回复混合、发送端有积压时的开销
+//
+// 每轮追加一批回复(15个128B的小回复和1个大回复)，然后发送一次：
+//   queue:  不走系统调用，每轮只取走固定的64KiB，模拟对端读得慢、输出缓冲区积压，只比较追加和取走的开销
+//   socket: 写到socketpair，另一个线程一直读，Buffer用write，OutputChain用writev
+// chain+slice中大回复用append_slice借用同一份数据，不拷贝
+//
+// usage: output_chain_bench [rounds] [large_reply_kbytes]
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "muduo/src/buffer.h"
+#include "muduo/src/output_chain.h"
+
+using namespace muduo;
+
+namespace {
+
+const int    kSmallPerRound = 15;
+const size_t kSmallSize = 128;
+const size_t kDrainPerRound = 64 * 1024;
+
+struct Replies {
+  std::string                        small;
+  std::shared_ptr<const std::string> large;
+};
+
+double now_ns() {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 三种输出缓冲区的统一接口
+struct BufferOutput {
+  Buffer buf;
+  void   append_small(const Replies &r) { buf.append(r.small); }
+  void   append_large(const Replies &r) { buf.append(*r.large); }
+  size_t pending() const { return buf.readable_bytes(); }
+  void   drop(size_t len) { buf.retrieve(len); }
+  void   flush(int fd) {
+    ssize_t n = ::write(fd, buf.peek(), buf.readable_bytes());
+    if (n > 0) buf.retrieve(static_cast<size_t>(n));
+  }
+};
+
+struct ChainOutput {
+  OutputChain chain;
+  void        append_small(const Replies &r) { chain.append(r.small); }
+  void        append_large(const Replies &r) { chain.append(*r.large); }
+  size_t      pending() const { return chain.readable_bytes(); }
+  void        drop(size_t len) { chain.retrieve(len); }
+  void        flush(int fd) {
+    int saved_errno = 0;
+    chain.write_fd(fd, &saved_errno);
+  }
+};
+
+struct SliceOutput : ChainOutput {
+  void append_large(const Replies &r) { chain.append_slice(*r.large, r.large); }
+};
+
+template <typename Output>
+void bench_queue(const char *name, const Replies &replies, int rounds) {
+  Output out;
+  double start = now_ns();
+  for (int i = 0; i < rounds; ++i) {
+    for (int j = 0; j < kSmallPerRound; ++j) out.append_small(replies);
+    out.append_large(replies);
+    out.drop(std::min(out.pending(), kDrainPerRound));
+  }
+  double  ns = now_ns() - start;
+  int64_t bytes = static_cast<int64_t>(rounds) * (kSmallPerRound * kSmallSize + replies.large->size());
+  printf("%-12s queue   large=%-8zu ns/round=%-10.1f backlog=%zuKiB GB/s=%.2f\n", name, replies.large->size(),
+         ns / rounds, out.pending() / 1024, bytes / ns);
+}
+
+template <typename Output>
+void bench_socket(const char *name, const Replies &replies, int rounds) {
+  int fds[ 2 ];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    perror("socketpair");
+    exit(1);
+  }
+  ::fcntl(fds[ 0 ], F_SETFL, O_NONBLOCK);
+  int64_t     bytes = static_cast<int64_t>(rounds) * (kSmallPerRound * kSmallSize + replies.large->size());
+  std::thread reader([ fd = fds[ 1 ], bytes ] {
+    char    buf[ 65536 ];
+    int64_t received = 0;
+    while (received < bytes) {
+      ssize_t n = ::read(fd, buf, sizeof buf);
+      if (n <= 0) break;
+      received += n;
+    }
+  });
+  Output out;
+  double start = now_ns();
+  for (int i = 0; i < rounds; ++i) {
+    for (int j = 0; j < kSmallPerRound; ++j) out.append_small(replies);
+    out.append_large(replies);
+    out.flush(fds[ 0 ]);
+  }
+  while (out.pending() > 0) out.flush(fds[ 0 ]);
+  reader.join();
+  double ns = now_ns() - start;
+  printf("%-12s socket  large=%-8zu ns/round=%-10.1f GB/s=%.2f\n", name, replies.large->size(), ns / rounds,
+         bytes / ns);
+  ::close(fds[ 0 ]);
+  ::close(fds[ 1 ]);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[ 1 ]) : 2000;
+  for (size_t large_kbytes : {size_t(16), size_t(256), size_t(1024)}) {
+    if (argc > 2) large_kbytes = static_cast<size_t>(atoi(argv[ 2 ]));
+    Replies replies;
+    replies.small.assign(kSmallSize, 's');
+    replies.large = std::make_shared<const std::string>(large_kbytes * 1024, 'L');
+    // 积压会一直增长，大回复越大轮数越少
+    int n = static_cast<int>(std::max<size_t>(rounds * 16 / large_kbytes, 50));
+    bench_queue<BufferOutput>("buffer", replies, n);
+    bench_queue<ChainOutput>("chain", replies, n);
+    bench_queue<SliceOutput>("chain+slice", replies, n);
+    bench_socket<BufferOutput>("buffer", replies, n);
+    bench_socket<ChainOutput>("chain", replies, n);
+    bench_socket<SliceOutput>("chain+slice", replies, n);
+    if (argc > 2) break;
+  }
+}
@@ -0,0 +1,113 @@
+// 对比 EventLoop pending functors 的两种实现在多生产者竞争下的吞吐
+// 1. mutex + vector，消费者swap（原来的实现）
+// 2. MpscQueue，消费者take_all（现在的实现）
+//
+// usage: pending_functors_bench [producers] [tasks_per_producer]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "muduo/src/mpsc_queue.h"
+
+using namespace muduo;
+
+namespace {
+
+class MutexQueue {
+public:
+  void push(std::function<void()> func) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _functors.push_back(std::move(func));
+  }
+  size_t run_all() {
+    std::vector<std::function<void()>> functors;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      functors.swap(_functors);
+    }
+    for (const auto &func : functors) {
+      func();
+    }
+    return functors.size();
+  }
+
+private:
+  std::mutex                         _mutex;
+  std::vector<std::function<void()>> _functors;
+};
+
+class LockFreeQueue {
+public:
+  void   push(std::function<void()> func) { _queue.push(std::move(func)); }
+  size_t run_all() {
+    auto   functors = _queue.take_all();
+    size_t n = functors.size();
+    for (; !functors.empty(); functors.pop_front()) {
+      functors.front()();
+    }
+    return n;
+  }
+
+private:
+  MpscQueue<std::function<void()>> _queue;
+};
+
+template <typename Queue>
+double run(const char *name, int producers, int tasks_per_producer) {
+  Queue             queue;
+  std::atomic<int>  ready{0};
+  std::atomic<bool> go{false};
+  int64_t           sum = 0;
+  const size_t      total = static_cast<size_t>(producers) * tasks_per_producer;
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([ & ] {
+      ++ready;
+      while (!go) {
+      }
+      for (int i = 0; i < tasks_per_producer; ++i) {
+        queue.push([ &sum ] { ++sum; });
+      }
+    });
+  }
+  while (ready != producers) {
+  }
+
+  auto   start = std::chrono::steady_clock::now();
+  size_t done = 0;
+  go = true;
+  while (done < total) {
+    done += queue.run_all();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  double mops = static_cast<double>(total) / elapsed / 1e6;
+  printf("%-10s producers=%-3d tasks=%-10zu elapsed=%.3fs throughput=%.2f Mops/s sum=%ld\n", name, producers, total,
+         elapsed, mops, sum);
+  return mops;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int max_producers = argc > 1 ? atoi(argv[ 1 ]) : static_cast<int>(std::thread::hardware_concurrency());
+  int tasks_per_producer = argc > 2 ? atoi(argv[ 2 ]) : 1000000;
+  if (max_producers <= 0) max_producers = 1;
+
+  for (int producers = 1; producers <= max_producers; producers *= 2) {
+    double mutex_mops = run<MutexQueue>("mutex", producers, tasks_per_producer);
+    double mpsc_mops = run<LockFreeQueue>("mpsc", producers, tasks_per_producer);
+    printf("producers=%d speedup=%.2fx\n\n", producers, mpsc_mops / mutex_mops);
+  }
+}
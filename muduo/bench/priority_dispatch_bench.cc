@@ -0,0 +1,164 @@
+// 大流量连接占满loop时，控制连接的延迟：控制连接为普通优先级和高优先级的对比
+//
+// 一个loop上有若干条被灌满的bulk连接(socketpair上的Channel)，每次可读都读64KB并做一遍校验和，
+// 另一条控制连接是同一个loop上TcpServer接受的TCP连接，用TcpConnection::set_priority设置优先级，
+// 每1ms收到一个8字节的时间戳，统计从发送到控制连接的消息回调被执行的延迟。
+//
+// usage: priority_dispatch_bench [bulk_streams] [seconds]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "muduo/src/channel.h"
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_thread.h"
+#include "muduo/src/inet_address.h"
+#include "muduo/src/loop_stats.h"
+#include "muduo/src/tcpserver.h"
+
+using namespace muduo;
+
+namespace {
+
+struct Stream {
+  int                      fds[ 2 ];
+  std::unique_ptr<Channel> channel;
+};
+
+uint64_t g_checksum = 0;
+
+void make_stream(Stream *stream) {
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, stream->fds) != 0) {
+    perror("socketpair");
+    exit(1);
+  }
+}
+
+int connect_to(uint16_t port) {
+  int                sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0x00, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr) != 0) {
+    perror("connect");
+    exit(1);
+  }
+  int on = 1;
+  ::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+  return sockfd;
+}
+
+void run(int num_bulk, int seconds, Channel::Priority control_priority, uint16_t port) {
+  EventLoopThread loop_thread(EventLoopThread::ThreadInitCallback(), "priority_bench");
+  EventLoop      *loop = loop_thread.start_loop();
+
+  std::vector<Stream>        bulks(num_bulk);
+  std::unique_ptr<TcpServer> server;
+  std::atomic<bool>          control_up{false};
+  std::vector<int64_t>       latencies;
+  for (auto &bulk : bulks) make_stream(&bulk);
+
+  std::promise<void> setup;
+  loop->run_in_loop([ & ] {
+    for (auto &bulk : bulks) {
+      bulk.channel.reset(new Channel(loop, bulk.fds[ 0 ]));
+      int fd = bulk.fds[ 0 ];
+      bulk.channel->set_read_callback([ fd ](Timestamp) {
+        static char buf[ 64 * 1024 ];
+        ssize_t     n = ::read(fd, buf, sizeof buf);
+        for (ssize_t i = 0; i < n; ++i) g_checksum += static_cast<unsigned char>(buf[ i ]);
+      });
+      bulk.channel->enable_reading();
+    }
+    server.reset(new TcpServer(loop, InetAddress(port, true), "control"));
+    server->set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+      if (conn->connected()) {
+        conn->set_priority(control_priority);
+        control_up = true;
+      }
+    });
+    server->set_message_callback([ & ](const std::shared_ptr<TcpConnection> &, Buffer *buf, Timestamp) {
+      while (buf->readable_bytes() >= sizeof(int64_t)) {
+        int64_t sent_ns;
+        memcpy(&sent_ns, buf->peek(), sizeof sent_ns);
+        buf->retrieve(sizeof sent_ns);
+        latencies.push_back(monotonic_ns() - sent_ns);
+      }
+    });
+    server->start();
+    setup.set_value();
+  });
+  setup.get_future().wait();
+  int control_fd = connect_to(port);
+  while (!control_up) ::usleep(1000);
+
+  std::atomic<bool> stop{false};
+  std::thread       feeder([ & ] {
+    static char chunk[ 64 * 1024 ];
+    memset(chunk, 'x', sizeof chunk);
+    while (!stop) {
+      for (auto &bulk : bulks) {
+        ssize_t n = ::write(bulk.fds[ 1 ], chunk, sizeof chunk);
+        (void)n;
+      }
+    }
+  });
+
+  int64_t deadline = monotonic_ns() + static_cast<int64_t>(seconds) * 1000000000;
+  while (monotonic_ns() < deadline) {
+    int64_t now = monotonic_ns();
+    ssize_t n = ::write(control_fd, &now, sizeof now);
+    (void)n;
+    ::usleep(1000);
+  }
+  stop = true;
+  feeder.join();
+
+  std::promise<void> teardown;
+  loop->run_in_loop([ & ] {
+    for (auto &bulk : bulks) {
+      bulk.channel->disable_all();
+      bulk.channel->remove();
+    }
+    server.reset();
+    teardown.set_value();
+  });
+  teardown.get_future().wait();
+  for (auto &bulk : bulks) {
+    ::close(bulk.fds[ 0 ]);
+    ::close(bulk.fds[ 1 ]);
+  }
+  ::close(control_fd);
+
+  std::sort(latencies.begin(), latencies.end());
+  if (latencies.empty()) latencies.push_back(0);
+  printf("control_priority=%-6s samples=%-6zu p50=%-8ldus p99=%-8ldus max=%-8ldus\n",
+         control_priority == Channel::kHighPriority ? "high" : "normal", latencies.size(),
+         latencies[ latencies.size() / 2 ] / 1000, latencies[ latencies.size() * 99 / 100 ] / 1000,
+         latencies.back() / 1000);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int num_bulk = argc > 1 ? atoi(argv[ 1 ]) : 64;
+  int seconds = argc > 2 ? atoi(argv[ 2 ]) : 5;
+  run(num_bulk, seconds, Channel::kNormalPriority, 19951);
+  run(num_bulk, seconds, Channel::kHighPriority, 19952);
+  printf("checksum=%lu\n", g_checksum);
+}
@@ -0,0 +1,101 @@
+// 对比TimerQueue的两种实现(std::set和分层时间轮)在大量定时器下的开销
+//
+// 在loop线程中直接调用run_after/cancel(同步执行，不经过pending functors)，依次测量：
+// add:        添加timers个定时器，到期时间在[2s, 4s)中随机分布
+// reschedule: 连接的空闲超时每收到一次数据就要推迟一次，取消一个随机的定时器再添加一个新的，共kRescheduleOps次
+// cancel:     取消一半的定时器
+// expire:     等到剩下的定时器全部到期后再运行loop，一轮处理完所有的定时器，CPU时间除以到期的定时器个数，
+//             不包含定时器分散到期时每次唤醒的开销
+//
+// usage: timer_queue_bench [max_timers]
+// 默认依次测试1万、100万、1000万个定时器，1000万个时set需要2GB以上的内存
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "muduo/src/event_loop.h"
+
+using namespace muduo;
+
+namespace {
+
+const int kRescheduleOps = 1000 * 1000;
+
+double elapsed_ns(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+int64_t thread_cpu_ns() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct ExpireState {
+  EventLoop *loop;
+  int64_t    fired;
+  int64_t    expected;
+};
+
+void run(const char *queue, int timers) {
+  ::setenv("MUDUO_TIMER_QUEUE", queue, 1);
+  EventLoop loop;
+
+  std::mt19937_64                        rng(timers);
+  std::uniform_real_distribution<double> delay(2.0, 4.0);
+  std::vector<double>                    delays(timers + kRescheduleOps);
+  for (auto &d : delays) d = delay(rng);
+  std::vector<TimerId> ids(timers);
+  ExpireState          state{&loop, 0, timers / 2};
+  // 回调只捕获一个指针，放得进std::function的内部缓冲区，两种实现都不会为回调额外分配内存
+  ExpireState *s = &state;
+  auto         on_expire = [ s ] {
+    if (++s->fired == s->expected) s->loop->quit();
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < timers; ++i) {
+    ids[ i ] = loop.run_after(delays[ i ], on_expire);
+  }
+  double add_ns = elapsed_ns(start) / timers;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRescheduleOps; ++i) {
+    size_t victim = rng() % timers;
+    loop.cancel(ids[ victim ]);
+    ids[ victim ] = loop.run_after(delays[ timers + i ], on_expire);
+  }
+  double reschedule_ns = elapsed_ns(start) / kRescheduleOps;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < timers; i += 2) {
+    loop.cancel(ids[ i ]);
+  }
+  double cancel_ns = elapsed_ns(start) / ((timers + 1) / 2);
+  state.expected = static_cast<int64_t>(loop.timer_count());
+  ::usleep(static_cast<useconds_t>(delay.max() * 1000 * 1000) + 100 * 1000);
+
+  int64_t cpu_start = thread_cpu_ns();
+  loop.loop();
+  double expire_ns = static_cast<double>(thread_cpu_ns() - cpu_start) / state.fired;
+
+  printf("queue=%-6s timers=%-9d ns/add=%-7.1f ns/reschedule=%-7.1f ns/cancel=%-7.1f ns/expire=%-7.1f\n", queue,
+         timers, add_ns, reschedule_ns, cancel_ns, expire_ns);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int max_timers = argc > 1 ? atoi(argv[ 1 ]) : 10 * 1000 * 1000;
+  for (int timers : {10 * 1000, 1000 * 1000, 10 * 1000 * 1000}) {
+    if (timers > max_timers) break;
+    run("set", timers);
+    run("wheel", timers);
+  }
+}
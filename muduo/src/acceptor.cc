@@ -16,12 +16,14 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listen_addr, bool reuse_p
     , _accept_socket(sockets::create_nonblocking_or_die(listen_addr.family()))
     , _accept_channel(loop, _accept_socket.fd())
     , _listening(false)
+    , _edge_triggered(false)
     , _idlefd(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
   assert(_idlefd >= 0);
   _accept_socket.set_reuse_addr(true);
   _accept_socket.set_reuse_port(reuse_port);
   _accept_socket.bind_address(listen_addr);
   _accept_channel.set_read_callback(std::bind(&Acceptor::handle_read, this));
+  _accept_channel.set_priority(Channel::kHighPriority);
 }
 
 Acceptor::~Acceptor() {
@@ -35,28 +37,50 @@ void Acceptor::listen() {
   _loop->assert_in_loop_thread();
   _listening = true;
   _accept_socket.listen();
+  if (_edge_triggered && _loop->supports_edge_triggered()) {
+    _accept_channel.set_edge_triggered(true);
+  }
   _accept_channel.enable_reading();
 }
 
 // channel的handle_read肯定是在I/O线程中调用的
+// 水平触发时每次事件accept一个，还有没accept的连接下一轮会再通知
+// 边沿触发时必须一直accept到EAGAIN，否则剩下的连接要等到下一个新连接到来才会再通知
 void Acceptor::handle_read() {
   _loop->assert_in_loop_thread();
+  if (_accept_channel.edge_triggered()) {
+    while (accept_one()) {
+    }
+  } else {
+    accept_one();
+  }
+}
+
+// @return: 是否还需要继续accept
+bool Acceptor::accept_one() {
   InetAddress peeraddr;
-  // FIXME: loop until no more
-  int connfd = _accept_socket.accept(&peeraddr);
+  int         connfd = _accept_socket.accept(&peeraddr);
   if (connfd >= 0) {
     if (_new_connection_callback) {
       _new_connection_callback(connfd, peeraddr);
     } else {
       sockets::close(connfd);
     }
-  } else {
-    LOG(ERROR) << "Acceptor::handle_read error.";
-    if (errno == EMFILE) {
-      ::close(_idlefd);
-      _idlefd = ::accept(_accept_socket.fd(), NULL, NULL);
-      ::close(_idlefd);
-      _idlefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
-    }
+    return true;
+  }
+  int saved_errno = errno;
+  if (saved_errno == EAGAIN || saved_errno == EWOULDBLOCK) {
+    return false;
+  }
+  LOG(ERROR) << "Acceptor::handle_read error.";
+  if (saved_errno == EMFILE) {
+    // 用预留的fd接受并立即关闭这个连接，不然它会一直留在backlog中
+    ::close(_idlefd);
+    _idlefd = ::accept(_accept_socket.fd(), NULL, NULL);
+    ::close(_idlefd);
+    _idlefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return true;
   }
+  // ECONNABORTED、EPROTO等只影响这一个连接，继续accept后面的；其他错误停下来
+  return saved_errno == ECONNABORTED || saved_errno == EPROTO || saved_errno == EINTR;
 }
\ No newline at end of file
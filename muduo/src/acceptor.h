@@ -17,16 +17,20 @@ public:
   ~Acceptor();
 
   void set_new_connection_callback(const NewConnectionCallback &cb) { _new_connection_callback = std::move(cb); }
+  // 必须在listen之前设置，poller不支持时仍然是水平触发
+  void set_edge_triggered(bool on) { _edge_triggered = on; }
   void listen();
   bool listening() const { return _listening; }
 
 private:
   void                  handle_read();
+  bool                  accept_one();
   EventLoop            *_loop;
   Socket                _accept_socket;
   Channel               _accept_channel;
   NewConnectionCallback _new_connection_callback;
   bool                  _listening;
+  bool                  _edge_triggered;
   int                   _idlefd;
 };
 } // namespace muduo
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "buffer.h"
+
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "chunk_pool.h"
+
+using namespace muduo;
+
+char Buffer::s_empty_storage[ Buffer::kCheapPrepend ];
+
+const size_t Buffer::kCheapPrepend;
+const size_t Buffer::kInitialSize;
+
+// 先读到可写空间，放不下的读到栈上的extrabuf再append，一次readv最多读可写空间加64KiB，
+// 不需要给每个连接的buffer预先分配很大的空间，也不需要先ioctl(FIONREAD)查询有多少数据
+// 可写空间已经不小于extrabuf时只用一块，读不完的留给下一次可读事件
+ssize_t Buffer::read_fd(int fd, int *saved_errno) {
+  char         extrabuf[ 65536 ];
+  struct iovec vec[ 2 ];
+  const size_t writable = writable_bytes();
+  vec[ 0 ].iov_base = begin_write();
+  vec[ 0 ].iov_len = writable;
+  vec[ 1 ].iov_base = extrabuf;
+  vec[ 1 ].iov_len = sizeof extrabuf;
+  const int iovcnt = writable < sizeof extrabuf ? 2 : 1;
+  ssize_t   n = ::readv(fd, vec, iovcnt);
+  if (n < 0) {
+    *saved_errno = errno;
+  } else if (static_cast<size_t>(n) <= writable) {
+    _writer_index += n;
+  } else {
+    _writer_index = _capacity;
+    append(extrabuf, n - writable);
+  }
+  return n;
+}
+
+void Buffer::grow(size_t len) {
+  const size_t readable = readable_bytes();
+  const size_t capacity = std::max(kCheapPrepend + readable + len, _capacity * 2);
+  // 从pool借的存储扩容时仍然从同一个pool分配，计入pool的用量
+  ChunkPool   *pool = _pool;
+  char        *storage = pool ? pool->allocate(capacity) : new char[ capacity ];
+  ::memcpy(storage + kCheapPrepend, peek(), readable);
+  free_storage();
+  _storage = storage;
+  _pool = pool;
+  _capacity = capacity;
+  _reader_index = kCheapPrepend;
+  _writer_index = kCheapPrepend + readable;
+}
+
+void Buffer::free_storage() {
+  if (!has_storage()) return;
+  if (_pool) {
+    _pool->deallocate(_storage, _capacity);
+  } else {
+    delete[] _storage;
+  }
+  _storage = s_empty_storage;
+  _capacity = kCheapPrepend;
+  _pool = nullptr;
+}
+
+void Buffer::borrow_from(ChunkPool *pool) {
+  assert(!has_storage());
+  _storage = pool->allocate();
+  _capacity = ChunkPool::kChunkSize;
+  _pool = pool;
+  retrieve_all();
+}
+
+void Buffer::release_storage() {
+  assert(readable_bytes() == 0);
+  free_storage();
+  retrieve_all();
+}
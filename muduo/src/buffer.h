@@ -1,8 +1,20 @@
 #pragma once
 
-#include <vector>
+#include <assert.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include "byte_search.h"
+#include "endian.h"
 
 namespace muduo {
+
+class ChunkPool;
+
 // A Buffer class modeled after org.jboss.netty.buffer.ChannelBuffer and is copyable
 // +-------------------+------------------+------------------+
 // | prependable bytes |  readable bytes  |  writable bytes  |
@@ -10,44 +22,283 @@ namespace muduo {
 // +-------------------+------------------+------------------+
 // |                   |                  |                  |
 // 0      <=      readerIndex   <=   writerIndex    <=     size
+//
+// 空间不够时，如果前面已经读走的空间加上后面的可写空间够用，就把可读数据挪到前面，不重新分配
+// 存储可以是自己分配的，也可以是从ChunkPool借的chunk；没有数据时可以release_storage，不占内存
+// find_crlf()/find_eol()记住已经查找过的前缀，消息分多次到达时每次只查找新追加的部分
 class Buffer {
 public:
   static const size_t kCheapPrepend = 8;
   static const size_t kInitialSize = 1024;
 
-  explicit Buffer(size_t initialize_size = kInitialSize)
-      : _buffer(kCheapPrepend + initial_size)
+  // initial_size为0时不分配存储，第一次写入时再分配
+  explicit Buffer(size_t initial_size = kInitialSize)
+      : _storage(initial_size > 0 ? new char[ kCheapPrepend + initial_size ] : s_empty_storage)
+      , _capacity(kCheapPrepend + initial_size)
+      , _pool(nullptr)
       , _reader_index(kCheapPrepend)
-      , _writer_index(kCheapPrepend) {
+      , _writer_index(kCheapPrepend)
+      , _crlf_scanned(0)
+      , _eol_scanned(0) {
     assert(readable_bytes() == 0); // 显然初始时刻，readable_bytes() == 0
     assert(writable_bytes() == initial_size);
     assert(prependable_bytes() == kCheapPrepend);
   }
+  // 只拷贝可读数据
+  Buffer(const Buffer &rhs)
+      : Buffer(rhs.readable_bytes()) {
+    append(rhs.peek(), rhs.readable_bytes());
+  }
+  Buffer(Buffer &&rhs) noexcept
+      : Buffer(0) {
+    swap(rhs);
+  }
+  Buffer &operator=(Buffer rhs) {
+    swap(rhs);
+    return *this;
+  }
+  ~Buffer() { free_storage(); }
 
-  // NOTE: implicit copy-ctor, move-ctor, assignment, dtor are fine
+  void swap(Buffer &rhs) {
+    std::swap(_storage, rhs._storage);
+    std::swap(_capacity, rhs._capacity);
+    std::swap(_pool, rhs._pool);
+    std::swap(_reader_index, rhs._reader_index);
+    std::swap(_writer_index, rhs._writer_index);
+    std::swap(_crlf_scanned, rhs._crlf_scanned);
+    std::swap(_eol_scanned, rhs._eol_scanned);
+  }
 
   size_t readable_bytes() const { return _writer_index - _reader_index; }
-  size_t writeable_bytes() const { return _buffer.size() - _writer_index; }
+  size_t writable_bytes() const { return _capacity - _writer_index; }
   size_t prependable_bytes() const { return _reader_index; } // 读指针前面的空间都是可以prepend的
 
   const char *peek() const { return begin() + _reader_index; } // _reader_index默认是从kCheapPrepend开始的
 
+  // 取走len字节的可读数据
+  void retrieve(size_t len) {
+    assert(len <= readable_bytes());
+    if (len < readable_bytes()) {
+      _reader_index += len;
+      _crlf_scanned = _crlf_scanned > len ? _crlf_scanned - len : 0;
+      _eol_scanned = _eol_scanned > len ? _eol_scanned - len : 0;
+    } else {
+      retrieve_all();
+    }
+  }
+  void retrieve_until(const char *end) {
+    assert(peek() <= end);
+    assert(end <= begin_write());
+    retrieve(end - peek());
+  }
+  void retrieve_all() {
+    _reader_index = kCheapPrepend;
+    _writer_index = kCheapPrepend;
+    _crlf_scanned = 0;
+    _eol_scanned = 0;
+  }
+  std::string retrieve_as_string(size_t len) {
+    assert(len <= readable_bytes());
+    std::string result(peek(), len);
+    retrieve(len);
+    return result;
+  }
+  std::string      retrieve_all_as_string() { return retrieve_as_string(readable_bytes()); }
+  std::string_view to_string_view() const { return std::string_view(peek(), readable_bytes()); }
+
+  // 以网络字节序读取整数，并取走对应的字节
+  void    retrieve_int64() { retrieve(sizeof(int64_t)); }
+  void    retrieve_int32() { retrieve(sizeof(int32_t)); }
+  void    retrieve_int16() { retrieve(sizeof(int16_t)); }
+  void    retrieve_int8() { retrieve(sizeof(int8_t)); }
+  int64_t read_int64() {
+    int64_t result = peek_int64();
+    retrieve_int64();
+    return result;
+  }
+  int32_t read_int32() {
+    int32_t result = peek_int32();
+    retrieve_int32();
+    return result;
+  }
+  int16_t read_int16() {
+    int16_t result = peek_int16();
+    retrieve_int16();
+    return result;
+  }
+  int8_t read_int8() {
+    int8_t result = peek_int8();
+    retrieve_int8();
+    return result;
+  }
+
+  // 以网络字节序读取整数，不取走
+  int64_t peek_int64() const {
+    assert(readable_bytes() >= sizeof(int64_t));
+    int64_t be64 = 0;
+    ::memcpy(&be64, peek(), sizeof be64);
+    return static_cast<int64_t>(sockets::network_to_host64(static_cast<uint64_t>(be64)));
+  }
+  int32_t peek_int32() const {
+    assert(readable_bytes() >= sizeof(int32_t));
+    int32_t be32 = 0;
+    ::memcpy(&be32, peek(), sizeof be32);
+    return static_cast<int32_t>(sockets::network_to_host32(static_cast<uint32_t>(be32)));
+  }
+  int16_t peek_int16() const {
+    assert(readable_bytes() >= sizeof(int16_t));
+    int16_t be16 = 0;
+    ::memcpy(&be16, peek(), sizeof be16);
+    return static_cast<int16_t>(sockets::network_to_host16(static_cast<uint16_t>(be16)));
+  }
+  int8_t peek_int8() const {
+    assert(readable_bytes() >= sizeof(int8_t));
+    return static_cast<int8_t>(*peek());
+  }
+
+  // 在可读数据中查找，找不到返回nullptr，实现见byte_search.h
+  // 不带start的版本从上次查找停下的地方继续，结果和从peek()开始查找一样
+  const char *find_crlf() const {
+    const char *crlf = find_crlf(peek() + _crlf_scanned);
+    // 最后一个字节可能是'\r'，下次要从它开始
+    size_t readable = readable_bytes();
+    _crlf_scanned = crlf ? crlf - peek() : (readable > 0 ? readable - 1 : 0);
+    return crlf;
+  }
+  const char *find_crlf(const char *start) const {
+    assert(peek() <= start);
+    assert(start <= begin_write());
+    return byte_search::find_crlf(start, begin_write());
+  }
+  const char *find_eol() const {
+    const char *eol = find_eol(peek() + _eol_scanned);
+    _eol_scanned = eol ? eol - peek() : readable_bytes();
+    return eol;
+  }
+  const char *find_eol(const char *start) const { return find_byte(start, '\n'); }
+  const char *find_byte(char c) const { return find_byte(peek(), c); }
+  const char *find_byte(const char *start, char c) const {
+    assert(peek() <= start);
+    assert(start <= begin_write());
+    return byte_search::find_byte(start, begin_write(), c);
+  }
+
+  void append(std::string_view str) { append(str.data(), str.size()); }
+  void append(const void *data, size_t len) { append(static_cast<const char *>(data), len); }
+  void append(const char *data, size_t len) {
+    ensure_writable_bytes(len);
+    std::copy(data, data + len, begin_write());
+    has_written(len);
+  }
+  // 以网络字节序追加整数
+  void append_int64(int64_t x) {
+    uint64_t be64 = sockets::host_to_network64(static_cast<uint64_t>(x));
+    append(&be64, sizeof be64);
+  }
+  void append_int32(int32_t x) {
+    uint32_t be32 = sockets::host_to_network32(static_cast<uint32_t>(x));
+    append(&be32, sizeof be32);
+  }
+  void append_int16(int16_t x) {
+    uint16_t be16 = sockets::host_to_network16(static_cast<uint16_t>(x));
+    append(&be16, sizeof be16);
+  }
+  void append_int8(int8_t x) { append(&x, sizeof x); }
+
+  void ensure_writable_bytes(size_t len) {
+    if (writable_bytes() < len) {
+      make_space(len);
+    }
+    assert(writable_bytes() >= len);
+  }
+
+  char       *begin_write() { return begin() + _writer_index; }
+  const char *begin_write() const { return begin() + _writer_index; }
+  void        has_written(size_t len) {
+    assert(len <= writable_bytes());
+    _writer_index += len;
+  }
+  // 撤销最后写入的len字节
+  void unwrite(size_t len) {
+    assert(len <= readable_bytes());
+    _writer_index -= len;
+    // 新的最后一个字节可能是'\r'
+    _crlf_scanned = std::min(_crlf_scanned, readable_bytes() > 0 ? readable_bytes() - 1 : 0);
+    _eol_scanned = std::min(_eol_scanned, readable_bytes());
+  }
+
+  void prepend(const void *data, size_t len) {
+    if (!has_storage()) grow(kInitialSize);
+    assert(len <= prependable_bytes());
+    _reader_index -= len;
+    _crlf_scanned = 0;
+    _eol_scanned = 0;
+    const char *d = static_cast<const char *>(data);
+    std::copy(d, d + len, begin() + _reader_index);
+  }
+  // 在可读数据前面以网络字节序写入整数，比如消息的长度头，需要prependable_bytes()足够
+  void prepend_int64(int64_t x) {
+    uint64_t be64 = sockets::host_to_network64(static_cast<uint64_t>(x));
+    prepend(&be64, sizeof be64);
+  }
+  void prepend_int32(int32_t x) {
+    uint32_t be32 = sockets::host_to_network32(static_cast<uint32_t>(x));
+    prepend(&be32, sizeof be32);
+  }
+  void prepend_int16(int16_t x) {
+    uint16_t be16 = sockets::host_to_network16(static_cast<uint16_t>(x));
+    prepend(&be16, sizeof be16);
+  }
+  void prepend_int8(int8_t x) { prepend(&x, sizeof x); }
+
+  // 释放多余的空间，只保留可读数据和reserve字节的可写空间
+  void shrink(size_t reserve) {
+    Buffer other(readable_bytes() + reserve);
+    other.append(peek(), readable_bytes());
+    swap(other);
+  }
+  size_t internal_capacity() const { return _capacity; }
+
+  bool has_storage() const { return _storage != s_empty_storage; }
+  // 没有存储时从pool借一个chunk，之后写入超过chunk大小时换成从同一个pool分配的更大的存储，chunk还给pool
+  void borrow_from(ChunkPool *pool);
+  // 没有可读数据时释放存储(借的还给pool)，之后不占内存，再次写入时重新分配
+  void release_storage();
+
+  // 从fd读数据到buffer中，返回readv的返回值，出错时设置saved_errno
+  ssize_t read_fd(int fd, int *saved_errno);
+
 private:
-  char       *begin() { return _buffer.data(); }
-  const char *begin() const { return _buffer.data(); }
+  char       *begin() { return _storage; }
+  const char *begin() const { return _storage; }
 
+  // 前面空出来的空间(保留kCheapPrepend)加上可写空间够用时，把可读数据挪到最前面，否则扩容
   void make_space(size_t len) {
     if (writable_bytes() + prependable_bytes() < len + kCheapPrepend) {
-      // TODO: move readable data
-      _buffer.resize(_writer_index + len);
+      grow(len);
     } else {
-      // move readable data to the front, make more space inside
+      assert(kCheapPrepend < _reader_index);
+      size_t readable = readable_bytes();
+      ::memmove(begin() + kCheapPrepend, begin() + _reader_index, readable);
+      _reader_index = kCheapPrepend;
+      _writer_index = _reader_index + readable;
+      assert(readable == readable_bytes());
     }
   }
 
-  std::vector<char> _buffer;
-  size_t            _reader_index;
-  size_t            _writer_index;
-  static const char kCRLF[]; // TODO: 这个怎么理解？
+  // 换成新分配的存储，大小至少翻倍，只拷贝可读数据
+  void grow(size_t len);
+  void free_storage();
+
+  char      *_storage; // 没有存储时指向s_empty_storage，_capacity为kCheapPrepend
+  size_t     _capacity;
+  ChunkPool *_pool; // 存储是从这个pool借的(chunk或者扩容之后的存储)，释放时还给它
+  size_t     _reader_index;
+  size_t     _writer_index;
+  // 可读数据的这么多字节中已经确定没有"\r\n"/'\n'，相对于_reader_index，挪动数据时不用更新
+  mutable size_t _crlf_scanned;
+  mutable size_t _eol_scanned;
+
+  static char s_empty_storage[ kCheapPrepend ];
 };
-} // namespace muduo
\ No newline at end of file
+} // namespace muduo
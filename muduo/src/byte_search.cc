@@ -0,0 +1,202 @@
+#include "byte_search.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace muduo;
+using namespace muduo::byte_search;
+
+namespace {
+
+const char *find_byte_scalar(const char *begin, const char *end, char c) {
+  return static_cast<const char *>(::memchr(begin, c, end - begin));
+}
+
+// 找'\r'再看下一个字节
+const char *find_crlf_scalar(const char *begin, const char *end) {
+  while (end - begin >= 2) {
+    const char *cr = static_cast<const char *>(::memchr(begin, '\r', end - begin - 1));
+    if (!cr) return nullptr;
+    if (cr[ 1 ] == '\n') return cr;
+    begin = cr + 1;
+  }
+  return nullptr;
+}
+
+#if defined(__x86_64__)
+
+inline __m128i  load16(const char *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+inline unsigned mask16(__m128i eq) { return static_cast<unsigned>(_mm_movemask_epi8(eq)); }
+
+__attribute__((target("avx2"))) inline __m256i load32(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+__attribute__((target("avx2"))) inline unsigned mask32(__m256i eq) {
+  return static_cast<unsigned>(_mm256_movemask_epi8(eq));
+}
+
+// 向下对齐到32字节
+inline const char *align32(const char *p) {
+  return reinterpret_cast<const char *>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(31));
+}
+
+// 4个block的比较结果中第一个命中的位置，至少有一个不为0
+inline size_t first_match(unsigned mask0, unsigned mask1, unsigned mask2, unsigned mask3, size_t block) {
+  if (mask0) return __builtin_ctz(mask0);
+  if (mask1) return block + __builtin_ctz(mask1);
+  if (mask2) return 2 * block + __builtin_ctz(mask2);
+  return 3 * block + __builtin_ctz(mask3);
+}
+
+// 每轮比较4个block，先把4个比较结果或起来判断有没有命中，没有命中时每个字节只做一次比较和一次或运算，
+// 命中之后再逐个block找位置。不足4个block的部分一个block一个block比较，最后不足一个block的交给下一级。
+// 4个结果用单独的变量而不是数组，数组会被放到栈上
+
+const char *find_byte_sse2(const char *begin, const char *end, char c) {
+  const __m128i needle = _mm_set1_epi8(c);
+  const char   *p = begin;
+  for (; end - p >= 64; p += 64) {
+    __m128i eq0 = _mm_cmpeq_epi8(load16(p), needle);
+    __m128i eq1 = _mm_cmpeq_epi8(load16(p + 16), needle);
+    __m128i eq2 = _mm_cmpeq_epi8(load16(p + 32), needle);
+    __m128i eq3 = _mm_cmpeq_epi8(load16(p + 48), needle);
+    if (!_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3)))) continue;
+    return p + first_match(mask16(eq0), mask16(eq1), mask16(eq2), mask16(eq3), 16);
+  }
+  for (; end - p >= 16; p += 16) {
+    unsigned mask = mask16(_mm_cmpeq_epi8(load16(p), needle));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return find_byte_scalar(p, end, c);
+}
+
+// p开始的block是'\r'、p+1开始的block是'\n'，两个结果相与就是"\r\n"的起点，不需要处理跨block的情况。
+// '\n'比'\r'少见(一般成对出现)，所以先只比较p+1开始的'\n'判断有没有命中
+const char *find_crlf_sse2(const char *begin, const char *end) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const char   *p = begin;
+  for (; end - p >= 65; p += 64) {
+    __m128i lf0 = _mm_cmpeq_epi8(load16(p + 1), lf);
+    __m128i lf1 = _mm_cmpeq_epi8(load16(p + 17), lf);
+    __m128i lf2 = _mm_cmpeq_epi8(load16(p + 33), lf);
+    __m128i lf3 = _mm_cmpeq_epi8(load16(p + 49), lf);
+    if (!_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(lf0, lf1), _mm_or_si128(lf2, lf3)))) continue;
+    unsigned mask0 = mask16(_mm_and_si128(_mm_cmpeq_epi8(load16(p), cr), lf0));
+    unsigned mask1 = mask16(_mm_and_si128(_mm_cmpeq_epi8(load16(p + 16), cr), lf1));
+    unsigned mask2 = mask16(_mm_and_si128(_mm_cmpeq_epi8(load16(p + 32), cr), lf2));
+    unsigned mask3 = mask16(_mm_and_si128(_mm_cmpeq_epi8(load16(p + 48), cr), lf3));
+    // 有'\n'但前面不是'\r'
+    if (!(mask0 | mask1 | mask2 | mask3)) continue;
+    return p + first_match(mask0, mask1, mask2, mask3, 16);
+  }
+  for (; end - p >= 17; p += 16) {
+    unsigned mask = mask16(_mm_and_si128(_mm_cmpeq_epi8(load16(p), cr), _mm_cmpeq_epi8(load16(p + 1), lf)));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return find_crlf_scalar(p, end);
+}
+
+__attribute__((target("avx2"))) const char *find_byte_avx2(const char *begin, const char *end, char c) {
+  const __m256i needle = _mm256_set1_epi8(c);
+  const char   *p = begin;
+  if (end - p >= 160) {
+    // 先比较开头一个不对齐的block，之后从它里面对齐的地方开始(重复比较的部分不会命中)，让主循环的load不跨cache line
+    unsigned mask = mask32(_mm256_cmpeq_epi8(load32(p), needle));
+    if (mask) return p + __builtin_ctz(mask);
+    p = align32(p + 32);
+  }
+  for (; end - p >= 128; p += 128) {
+    __m256i eq0 = _mm256_cmpeq_epi8(load32(p), needle);
+    __m256i eq1 = _mm256_cmpeq_epi8(load32(p + 32), needle);
+    __m256i eq2 = _mm256_cmpeq_epi8(load32(p + 64), needle);
+    __m256i eq3 = _mm256_cmpeq_epi8(load32(p + 96), needle);
+    __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+    if (_mm256_testz_si256(any, any)) continue;
+    return p + first_match(mask32(eq0), mask32(eq1), mask32(eq2), mask32(eq3), 32);
+  }
+  for (; end - p >= 32; p += 32) {
+    unsigned mask = mask32(_mm256_cmpeq_epi8(load32(p), needle));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return find_byte_sse2(p, end, c);
+}
+
+__attribute__((target("avx2"))) const char *find_crlf_avx2(const char *begin, const char *end) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const char   *p = begin;
+  if (end - p >= 161) {
+    // 主循环中'\n'的load对齐
+    unsigned mask = mask32(_mm256_and_si256(_mm256_cmpeq_epi8(load32(p), cr), _mm256_cmpeq_epi8(load32(p + 1), lf)));
+    if (mask) return p + __builtin_ctz(mask);
+    p = align32(p + 33) - 1;
+  }
+  for (; end - p >= 129; p += 128) {
+    __m256i lf0 = _mm256_cmpeq_epi8(load32(p + 1), lf);
+    __m256i lf1 = _mm256_cmpeq_epi8(load32(p + 33), lf);
+    __m256i lf2 = _mm256_cmpeq_epi8(load32(p + 65), lf);
+    __m256i lf3 = _mm256_cmpeq_epi8(load32(p + 97), lf);
+    __m256i any = _mm256_or_si256(_mm256_or_si256(lf0, lf1), _mm256_or_si256(lf2, lf3));
+    if (_mm256_testz_si256(any, any)) continue;
+    unsigned mask0 = mask32(_mm256_and_si256(_mm256_cmpeq_epi8(load32(p), cr), lf0));
+    unsigned mask1 = mask32(_mm256_and_si256(_mm256_cmpeq_epi8(load32(p + 32), cr), lf1));
+    unsigned mask2 = mask32(_mm256_and_si256(_mm256_cmpeq_epi8(load32(p + 64), cr), lf2));
+    unsigned mask3 = mask32(_mm256_and_si256(_mm256_cmpeq_epi8(load32(p + 96), cr), lf3));
+    if (!(mask0 | mask1 | mask2 | mask3)) continue;
+    return p + first_match(mask0, mask1, mask2, mask3, 32);
+  }
+  for (; end - p >= 33; p += 32) {
+    unsigned mask = mask32(_mm256_and_si256(_mm256_cmpeq_epi8(load32(p), cr), _mm256_cmpeq_epi8(load32(p + 1), lf)));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return find_crlf_sse2(p, end);
+}
+
+#endif
+
+const Kernels g_kernels[] = {
+  {kScalar, "scalar", find_byte_scalar, find_crlf_scalar},
+#if defined(__x86_64__)
+  {kSse2, "sse2", find_byte_sse2, find_crlf_sse2},
+  {kAvx2, "avx2", find_byte_avx2, find_crlf_avx2},
+#endif
+};
+
+Level supported_level() {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? kAvx2 : kSse2;
+#else
+  return kScalar;
+#endif
+}
+
+const Kernels &select_kernels() {
+  Level       level = supported_level();
+  const char *env = ::getenv("MUDUO_SIMD");
+  if (env) {
+    Level requested = level;
+    if (strcmp(env, "scalar") == 0) {
+      requested = kScalar;
+    } else if (strcmp(env, "sse2") == 0) {
+      requested = kSse2;
+    }
+    if (requested < level) level = requested;
+  }
+  return g_kernels[ level ];
+}
+
+} // namespace
+
+const Kernels &byte_search::active() {
+  static const Kernels &kernels = select_kernels();
+  return kernels;
+}
+
+const Kernels *byte_search::kernels(Level level) { return level <= supported_level() ? &g_kernels[ level ] : nullptr; }
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace muduo {
+namespace byte_search {
+
+// Buffer中查找分隔符用的几个函数，按CPU支持的指令集在运行时选择实现：
+//   kAvx2:   每次比较32字节
+//   kSse2:   每次比较16字节，x86-64上总是可用
+//   kScalar: memchr，其他架构上只有这一种
+// 环境变量MUDUO_SIMD=scalar|sse2|avx2可以把级别调低，方便对比和排查问题，超过CPU支持的级别时不生效
+enum Level { kScalar, kSse2, kAvx2 };
+
+// 返回[begin, end)中第一个c的位置，找不到返回nullptr
+typedef const char *(*FindByte)(const char *begin, const char *end, char c);
+// 返回[begin, end)中第一个"\r\n"中'\r'的位置，找不到返回nullptr
+typedef const char *(*FindCrlf)(const char *begin, const char *end);
+
+struct Kernels {
+  Level       level;
+  const char *name;
+  FindByte    find_byte;
+  FindCrlf    find_crlf;
+};
+
+// 当前使用的实现，第一次调用时选择
+const Kernels &active();
+// 指定级别的实现，CPU不支持时返回nullptr，给测试和bench用
+const Kernels *kernels(Level level);
+
+inline const char *find_byte(const char *begin, const char *end, char c) { return active().find_byte(begin, end, c); }
+inline const char *find_crlf(const char *begin, const char *end) { return active().find_crlf(begin, end); }
+
+} // namespace byte_search
+} // namespace muduo
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 
+#include "inline_function.h"
 #include "timestamp.h"
 
 namespace muduo {
 
+// reactor内部使用的回调，只移动不拷贝，小对象不做堆分配
+using Functor = InlineFunction<void()>;
+using TimerCallback = InlineFunction<void()>;
+
 class Buffer;
 class TcpConnection;
 using ConnectionCallback = std::function<void(const std::shared_ptr<TcpConnection> &)>;
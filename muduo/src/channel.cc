@@ -19,6 +19,8 @@ Channel::Channel(EventLoop *loop, int fd)
     , _events(0)
     , _revents(0)
     , _index(-1)
+    , _priority(kNormalPriority)
+    , _edge_triggered(false)
     , _log_hup(false)
     , _tied(false)
     , _event_handling(false)
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <functional>
+#include <assert.h>
+
 #include <memory>
 
+#include "inline_function.h"
 #include "timestamp.h"
 
 namespace muduo {
@@ -16,8 +18,13 @@ class EventLoop;
 // 不拥有fd就意味着不负责管理fd相关的OS资源，Channel析构时不负责close该fd
 class Channel {
 public:
-  using EventCallback = std::function<void()>;
-  using ReadEventCallback = std::function<void(Timestamp)>;
+  using EventCallback = InlineFunction<void()>;
+  using ReadEventCallback = InlineFunction<void(Timestamp)>;
+
+  // 同一轮poll返回的活动Channel按优先级分类处理，高优先级的先处理，同一优先级内保持poll返回的顺序
+  // 用于让wakeup、timerfd、监听socket和控制连接不被大流量的连接拖慢
+  enum Priority { kHighPriority = 0, kNormalPriority = 1, kLowPriority = 2 };
+  static const int kNumPriorities = 3;
 
   // Channel不拥有fd，在析构的时候不close(fd)
   Channel(EventLoop *loop, int fd);
@@ -66,6 +73,18 @@ public:
   int  index() const { return _index; }
   void set_index(int idx) { _index = idx; }
 
+  Priority priority() const { return _priority; }
+  void     set_priority(Priority priority) { _priority = priority; }
+
+  // 边沿触发(EPOLLET)，只有EventLoop::supports_edge_triggered()时才能打开，必须在关注任何事件之前设置
+  // 打开后每次就绪只通知一次，回调必须一直读/写到EAGAIN，否则剩下的数据在下一次边沿之前不会再通知；
+  // 反过来，可写事件可以一直关注着，不需要每次输出缓冲区清空/非空时disable_writing/enable_writing
+  bool edge_triggered() const { return _edge_triggered; }
+  void set_edge_triggered(bool on) {
+    assert(is_none_event());
+    _edge_triggered = on;
+  }
+
   std::string revents_to_string() const;
   std::string events_to_string() const;
 
@@ -92,6 +111,8 @@ private:
   int        _events;
   int        _revents; // received event types
   int        _index;   // used by poller.
+  Priority   _priority;
+  bool       _edge_triggered;
   bool       _log_hup;
 
   std::weak_ptr<void> _tie;
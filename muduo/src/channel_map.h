@@ -0,0 +1,56 @@
+#pragma once
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace muduo {
+
+class Channel;
+
+// fd到Channel的映射，Poller使用
+//
+// fd是进程内从小到大分配的小整数，而且内核总是复用最小的空闲fd，所以直接用fd做下标的数组就足够稠密，
+// 查找、插入、删除都是一次下标访问，不像std::map那样每次都要走一遍红黑树、追着指针访问分散的节点。
+// 数组只增长不收缩，大小就是进程用过的最大fd，和epoll_event数组等其他按fd数分配的结构同一个量级。
+// 只能在loop线程中使用。
+class ChannelMap {
+public:
+  // 不存在时返回nullptr
+  Channel *find(int fd) const {
+    assert(fd >= 0);
+    return static_cast<size_t>(fd) < _slots.size() ? _slots[ fd ] : nullptr;
+  }
+  bool contains(int fd) const { return find(fd) != nullptr; }
+
+  void insert(int fd, Channel *ch) {
+    assert(fd >= 0);
+    assert(ch != nullptr);
+    if (static_cast<size_t>(fd) >= _slots.size()) {
+      // 按2倍增长，fd逐个递增时摊还O(1)
+      _slots.resize(std::max(static_cast<size_t>(fd) + 1, _slots.size() * 2), nullptr);
+    }
+    assert(_slots[ fd ] == nullptr);
+    _slots[ fd ] = ch;
+    ++_size;
+  }
+
+  // 返回删除的个数，和std::map::erase一致
+  size_t erase(int fd) {
+    if (!contains(fd)) return 0;
+    _slots[ fd ] = nullptr;
+    --_size;
+    return 1;
+  }
+
+  size_t size() const { return _size; }
+  bool   empty() const { return _size == 0; }
+
+private:
+  std::vector<Channel *> _slots;
+  size_t                 _size = 0;
+};
+
+} // namespace muduo
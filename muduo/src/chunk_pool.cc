@@ -0,0 +1,136 @@
+#include "chunk_pool.h"
+
+#include <assert.h>
+
+#include "current_thread.h"
+
+using namespace muduo;
+
+const size_t ChunkPool::kChunkSize;
+const size_t ChunkPool::kDefaultMaxPooledBytes;
+
+namespace {
+std::atomic<int64_t> g_total_bytes{0};
+std::atomic<int64_t> g_memory_limit{0};
+} // namespace
+
+ChunkPool::ChunkPool()
+    : _threadid(tid())
+    , _max_pooled_chunks(kDefaultMaxPooledBytes / kChunkSize)
+    , _pooled_bytes(0)
+    , _borrowed_bytes(0)
+    , _peak_borrowed_bytes(0)
+    , _over_limit_allocations(0) {}
+
+// 借出去的chunk由借用者归还，pool通过shared_ptr的生命周期保证析构时没有借出的chunk
+ChunkPool::~ChunkPool() {
+  assert(_borrowed_bytes.load() == 0);
+  for (char *chunk : _free_chunks) free_chunk(chunk);
+}
+
+bool ChunkPool::in_loop_thread() const { return _threadid == tid(); }
+
+void ChunkPool::free_chunk(char *chunk) {
+  delete[] chunk;
+  g_total_bytes.fetch_sub(kChunkSize, std::memory_order_relaxed);
+}
+
+char *ChunkPool::allocate() {
+  assert(in_loop_thread());
+  char *chunk;
+  if (!_free_chunks.empty()) {
+    chunk = _free_chunks.back();
+    _free_chunks.pop_back();
+    _pooled_bytes.store(_free_chunks.size() * kChunkSize, std::memory_order_relaxed);
+  } else {
+    chunk = new char[ kChunkSize ];
+    g_total_bytes.fetch_add(kChunkSize, std::memory_order_relaxed);
+    if (over_memory_limit()) _over_limit_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  add_borrowed(kChunkSize);
+  return chunk;
+}
+
+char *ChunkPool::allocate(size_t size) {
+  if (size == kChunkSize) return allocate();
+  assert(in_loop_thread());
+  char *data = new char[ size ];
+  g_total_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+  if (over_memory_limit()) _over_limit_allocations.fetch_add(1, std::memory_order_relaxed);
+  add_borrowed(static_cast<int64_t>(size));
+  return data;
+}
+
+void ChunkPool::add_borrowed(int64_t bytes) {
+  int64_t borrowed = _borrowed_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  if (borrowed > _peak_borrowed_bytes.load(std::memory_order_relaxed)) {
+    _peak_borrowed_bytes.store(borrowed, std::memory_order_relaxed);
+  }
+}
+
+void ChunkPool::deallocate(char *chunk) {
+  _borrowed_bytes.fetch_sub(kChunkSize, std::memory_order_relaxed);
+  if (!in_loop_thread()) {
+    free_chunk(chunk);
+    return;
+  }
+  if (over_memory_limit()) {
+    free_chunk(chunk);
+    trim();
+    return;
+  }
+  if (_free_chunks.size() >= _max_pooled_chunks) {
+    free_chunk(chunk);
+    return;
+  }
+  _free_chunks.push_back(chunk);
+  _pooled_bytes.store(_free_chunks.size() * kChunkSize, std::memory_order_relaxed);
+}
+
+// 不是chunk的存储不缓存，可以在任意线程中归还
+void ChunkPool::deallocate(char *data, size_t size) {
+  if (size == kChunkSize) {
+    deallocate(data);
+    return;
+  }
+  _borrowed_bytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+  delete[] data;
+  g_total_bytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+
+ChunkPool::Stats ChunkPool::stats() const {
+  Stats stats;
+  stats.pooled_bytes = _pooled_bytes.load(std::memory_order_relaxed);
+  stats.borrowed_bytes = _borrowed_bytes.load(std::memory_order_relaxed);
+  stats.peak_borrowed_bytes = _peak_borrowed_bytes.load(std::memory_order_relaxed);
+  stats.over_limit_allocations = _over_limit_allocations.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ChunkPool::set_max_pooled_bytes(size_t bytes) {
+  assert(in_loop_thread());
+  _max_pooled_chunks = bytes / kChunkSize;
+  while (_free_chunks.size() > _max_pooled_chunks) {
+    free_chunk(_free_chunks.back());
+    _free_chunks.pop_back();
+  }
+  _pooled_bytes.store(_free_chunks.size() * kChunkSize, std::memory_order_relaxed);
+}
+
+void ChunkPool::trim() {
+  assert(in_loop_thread());
+  for (char *chunk : _free_chunks) free_chunk(chunk);
+  _free_chunks.clear();
+  _pooled_bytes.store(0, std::memory_order_relaxed);
+}
+
+int64_t ChunkPool::total_bytes() { return g_total_bytes.load(std::memory_order_relaxed); }
+
+void ChunkPool::set_memory_limit(int64_t bytes) { g_memory_limit.store(bytes, std::memory_order_relaxed); }
+
+int64_t ChunkPool::memory_limit() { return g_memory_limit.load(std::memory_order_relaxed); }
+
+bool ChunkPool::over_memory_limit() {
+  int64_t limit = g_memory_limit.load(std::memory_order_relaxed);
+  return limit > 0 && g_total_bytes.load(std::memory_order_relaxed) > limit;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <boost/noncopyable.hpp>
+#include <vector>
+
+namespace muduo {
+
+// 每个EventLoop一个，缓存固定大小的chunk，给连接的输入Buffer和输出OutputChain使用
+//
+// 连接只在有数据待处理时(输入中还没处理完的部分、还没发送出去的输出)借用chunk，处理完立即归还，
+// 大量空闲连接不占用缓冲区内存。归还的chunk缓存在空闲列表中，给同一个loop上的其他连接复用，
+// 每个pool缓存的字节数不超过max_pooled_bytes。
+//
+// 输入Buffer超过一个chunk之后换成的更大的存储也从pool分配(allocate(size))，计入借出的字节数，但不缓存。
+//
+// 所有pool借出和缓存的内存总量可以设置一个全局上限(set_memory_limit)。超过之后归还的chunk直接释放，
+// 已经缓存的也一起释放；TcpConnection暂停读(不再为新的输入分配内存)，总量降到上限以下之后恢复。
+// 借用本身不会失败，不丢数据也不阻塞loop，只记录超限之后分配的次数；send()追加的输出不受限制，
+// 由应用通过high water mark回调控制。读被暂停的连接要等其他连接的数据被处理、发送出去才能恢复，
+// 应用不能依赖一直不处理的输入等到更多的输入。
+//
+// allocate、set_max_pooled_bytes、trim只能在loop线程中调用；deallocate可以在任意线程中调用，
+// 不在loop线程中时直接释放(比如连接最后在其他线程中析构)。统计可以在任意线程中读取。
+class ChunkPool : public boost::noncopyable {
+public:
+  static const size_t kChunkSize = 16 * 1024;
+
+  struct Stats {
+    int64_t pooled_bytes;           // 空闲列表中缓存的
+    int64_t borrowed_bytes;         // 正在被连接使用的
+    int64_t peak_borrowed_bytes;    // borrowed_bytes的最大值
+    int64_t over_limit_allocations; // 超过全局上限之后的分配次数
+  };
+
+  ChunkPool();
+  ~ChunkPool();
+
+  char *allocate();
+  void  deallocate(char *chunk);
+  // 任意大小的存储，size为kChunkSize时就是allocate()/deallocate()；归还时必须给出同样的size
+  char *allocate(size_t size);
+  void  deallocate(char *data, size_t size);
+  Stats stats() const;
+
+  void   set_max_pooled_bytes(size_t bytes);
+  size_t max_pooled_bytes() const { return _max_pooled_chunks * kChunkSize; }
+  // 释放所有缓存的chunk
+  void   trim();
+
+  // 所有pool借出和缓存的总字节数
+  static int64_t total_bytes();
+  // 0表示不限制(默认)
+  static void    set_memory_limit(int64_t bytes);
+  static int64_t memory_limit();
+  static bool    over_memory_limit();
+
+private:
+  static const size_t kDefaultMaxPooledBytes = 4 * 1024 * 1024;
+
+  bool in_loop_thread() const;
+  void free_chunk(char *chunk);
+  void add_borrowed(int64_t bytes);
+
+  const pid_t          _threadid;
+  size_t               _max_pooled_chunks;
+  std::vector<char *>  _free_chunks;
+  std::atomic<int64_t> _pooled_bytes;
+  std::atomic<int64_t> _borrowed_bytes;
+  std::atomic<int64_t> _peak_borrowed_bytes;
+  std::atomic<int64_t> _over_limit_allocations;
+};
+
+} // namespace muduo
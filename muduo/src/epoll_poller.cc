@@ -1,8 +1,13 @@
 #include "epoll_poller.h"
 
 #include <glog/logging.h>
+#include <limits.h>
 #include <sys/epoll.h>
 #include <sys/poll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
 
 #include "channel.h"
 
@@ -21,20 +26,35 @@ const int kAdded = 1;
 const int kDeleted = 2;
 } // namespace
 
+namespace {
+#ifdef __NR_epoll_pwait2
+int epoll_pwait2(int epfd, struct epoll_event *events, int maxevents, const struct timespec *timeout) {
+  return static_cast<int>(::syscall(__NR_epoll_pwait2, epfd, events, maxevents, timeout, nullptr, 0));
+}
+#endif
+} // namespace
+
 EPollPoller::EPollPoller(EventLoop *loop)
     : Poller(loop)
     , _epollfd(epoll_create1(EPOLL_CLOEXEC))
+    , _has_epoll_pwait2(false)
     , _events(kInitEventListSize) {
   if (_epollfd < 0) {
     LOG(FATAL) << "create epoll fd failed, loop=" << loop;
   }
+#ifdef __NR_epoll_pwait2
+  // 用0超时探测一次，内核不支持时返回ENOSYS
+  struct timespec zero = {0, 0};
+  _has_epoll_pwait2 = epoll_pwait2(_epollfd, _events.data(), static_cast<int>(_events.size()), &zero) >= 0;
+#endif
 }
 
 EPollPoller::~EPollPoller() { close(_epollfd); }
 
-Timestamp EPollPoller::poll(int timeout_ms, std::vector<Channel *> *active_channels) {
+Timestamp EPollPoller::poll(int64_t timeout_us, std::vector<Channel *> *active_channels) {
+  apply_pending_updates();
   DLOG(INFO) << "total fd num=" << _channels.size() << " in epoll[" << this << "]";
-  int  num_events = epoll_wait(_epollfd, _events.data(), static_cast<int>(_events.size()), timeout_ms);
+  int  num_events = wait(timeout_us);
   int  saved_errno = errno;
   auto now = Timestamp::now();
   if (num_events > 0) {
@@ -44,7 +64,10 @@ Timestamp EPollPoller::poll(int timeout_ms, std::vector<Channel *> *active_chann
       _events.resize(_events.size() * 2);
     }
   } else if (num_events == 0) {
-    LOG(INFO) << "nothing happend in epoll[" << this << "]";
+    // 0超时的poll(busy poll，或者还有pending functors)落空是常态，不打日志
+    if (timeout_us != 0) {
+      LOG(INFO) << "nothing happend in epoll[" << this << "]";
+    }
   } else {
     // error happened
     if (saved_errno != EINTR) {
@@ -56,52 +79,93 @@ Timestamp EPollPoller::poll(int timeout_ms, std::vector<Channel *> *active_chann
   return now;
 }
 
+// epoll_wait的超时向上取整到毫秒，不会在定时器到期之前返回
+int EPollPoller::wait(int64_t timeout_us) {
+  ++_syscalls;
+  const int max_events = static_cast<int>(_events.size());
+#ifdef __NR_epoll_pwait2
+  if (_has_epoll_pwait2 && timeout_us > 0) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout_us / Timestamp::kMicroSecondsPerSecond);
+    ts.tv_nsec = static_cast<long>(timeout_us % Timestamp::kMicroSecondsPerSecond * 1000);
+    return epoll_pwait2(_epollfd, _events.data(), max_events, &ts);
+  }
+#endif
+  int timeout_ms = -1;
+  if (timeout_us >= 0) {
+    timeout_ms = static_cast<int>(std::min<int64_t>((timeout_us + 999) / 1000, INT_MAX));
+  }
+  return epoll_wait(_epollfd, _events.data(), max_events, timeout_ms);
+}
+
 void EPollPoller::fill_active_channels(int num_events, std::vector<Channel *> *active_channels) const {
   assert(static_cast<size_t>(num_events) <= _events.size());
   for (int i = 0; i < num_events; ++i) {
     Channel *ch = static_cast<Channel *>(_events[ i ].data.ptr);
-#ifndef NDEBUG
-    int  fd = ch->fd();
-    auto it = _channels.find(fd);
-    assert(it != _channels.end());
-    assert(it->second == ch);
-#endif
+    assert(_channels.find(ch->fd()) == ch);
     ch->set_revents(_events[ i ].events);
     active_channels->push_back(ch);
   }
 }
 
+// channel的index表示它在内核中的状态：kNew不在_channels中，kAdded已经注册到epollfd，kDeleted在_channels中但没有注册
+// 这里只更新_channels并记下fd，epoll_ctl推迟到apply_pending_updates
 void EPollPoller::update_channel(Channel *ch) {
   assert_in_loop_thread();
-  const int index = ch->index();
-  DLOG(INFO) << "fd=" << ch->fd() << ", events=" << ch->events() << ", index=" << ch->index();
-  if (index == kNew || index == kDeleted) {
-    int fd = ch->fd();
-    // if it's a new channel.
-    if (index == kNew) {
-      assert(_channels.find(fd) == _channels.end());
-      _channels[ fd ] = ch;
-    } else { // if this channel is marked deleted, but not real deleted from map.
-      assert(_channels.find(fd) != _channels.end());
-      assert(_channels[ fd ] == ch);
-    }
-    update(EPOLL_CTL_ADD, ch);
-    // TODO : check
-    ch->set_index(kAdded);
+  const int fd = ch->fd();
+  DLOG(INFO) << "fd=" << fd << ", events=" << ch->events() << ", index=" << ch->index();
+  if (ch->index() == kNew) {
+    _channels.insert(fd, ch);
+    ch->set_index(kDeleted);
   } else {
-    int fd = ch->fd();
-    assert(_channels.find(fd) != _channels.end());
-    assert(_channels[ fd ] == ch);
-    assert(index == kAdded);
-    if (ch->is_none_event()) {
-      // marked as non-event, delete it and mark it's index as kDeleted.
-      update(EPOLL_CTL_DEL, ch);
+    assert(_channels.find(fd) == ch);
+  }
+  if (static_cast<size_t>(fd) >= _interests.size()) {
+    _interests.resize(std::max(static_cast<size_t>(fd) + 1, _interests.size() * 2));
+  }
+  if (_interests[ fd ].pending_updates++ == 0) {
+    _pending_fds.push_back(fd);
+  }
+}
+
+// 每个修改过的fd只比较最终关注的事件和内核中注册的事件，需要时调用一次epoll_ctl
+void EPollPoller::apply_pending_updates() {
+  for (int fd : _pending_fds) {
+    Interest &interest = _interests[ fd ];
+    // 已经被remove_channel处理掉了
+    if (interest.pending_updates == 0) continue;
+    const int requested = interest.pending_updates;
+    interest.pending_updates = 0;
+    Channel *ch = _channels.find(fd);
+    assert(ch != nullptr);
+    const uint32_t events = static_cast<uint32_t>(ch->events()) | (ch->edge_triggered() ? static_cast<uint32_t>(EPOLLET) : 0);
+    int            op = 0;
+    if (ch->index() == kAdded) {
+      if (ch->is_none_event()) {
+        op = EPOLL_CTL_DEL;
+      } else if (events != interest.events || ch->edge_triggered()) {
+        // 边沿触发的channel在这一轮中被修改过(比如stop_read之后又start_read)，即使最终事件没变也要MOD，
+        // 内核在MOD时重新检查就绪状态，socket中已经有的数据才会再次通知
+        op = EPOLL_CTL_MOD;
+      }
+    } else if (!ch->is_none_event()) {
+      op = EPOLL_CTL_ADD;
+    }
+    if (op == 0) {
+      _elided_updates += requested;
+      continue;
+    }
+    _elided_updates += requested - 1;
+    update(op, ch);
+    if (op == EPOLL_CTL_DEL) {
       ch->set_index(kDeleted);
+      interest.events = 0;
     } else {
-      // not non-event, but actually it's event has changed, so update to epoll.
-      update(EPOLL_CTL_MOD, ch);
+      ch->set_index(kAdded);
+      interest.events = events;
     }
   }
+  _pending_fds.clear();
 }
 
 // 这里的channel的index表示的channel的状态
@@ -111,17 +175,23 @@ void EPollPoller::update_channel(Channel *ch) {
 void EPollPoller::remove_channel(Channel *ch) {
   assert_in_loop_thread();
   int fd = ch->fd();
-  assert(_channels.find(fd) != _channels.end());
-  assert(_channels[ fd ] == ch);
+  assert(_channels.find(fd) == ch);
   assert(ch->is_none_event());
   int index = ch->index();
   assert(index == kAdded || index == kDeleted);
   size_t n = _channels.erase(fd);
   (void)n;
   assert(n == 1);
+  // 没有提交的修改直接丢弃，还在内核中注册着的立即删除
+  Interest &interest = _interests[ fd ];
+  _elided_updates += interest.pending_updates;
   if (index == kAdded) {
+    // 逐次提交时最后一次disable_all的DEL就是这里的DEL，不算省掉
+    if (interest.pending_updates > 0) --_elided_updates;
     update(EPOLL_CTL_DEL, ch);
   }
+  interest.pending_updates = 0;
+  interest.events = 0;
   ch->set_index(kNew);
 }
 
@@ -142,10 +212,11 @@ const char *EPollPoller::operation_to_string(int op) {
 void EPollPoller::update(int op, Channel *ch) {
   struct epoll_event event;
   memset(&event, 0x00, sizeof(event));
-  event.events = ch->events();
+  event.events = static_cast<uint32_t>(ch->events()) | (ch->edge_triggered() ? static_cast<uint32_t>(EPOLLET) : 0);
   event.data.ptr = ch;
   int fd = ch->fd();
   DLOG(INFO) << "epoll_ctl op=" << operation_to_string(op) << ", fd=" << fd << ", event=" << ch->events_to_string();
+  ++_syscalls;
   if (epoll_ctl(_epollfd, op, fd, &event) < 0) {
     if (op == EPOLL_CTL_DEL) {
       LOG(WARNING) << "epoll_ctl_del for fd=" << fd << " failed.";
@@ -154,5 +225,3 @@ void EPollPoller::update(int op, Channel *ch) {
     }
   }
 }
-
-Poller *Poller::new_default_poller(EventLoop *loop) { return new EPollPoller(loop); }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 #include <vector>
 
 #include "poller.h"
@@ -9,24 +11,45 @@ struct epoll_event;
 namespace muduo {
 
 // epoll作为poller的实现
+//
+// update_channel只记录哪些fd的关注事件变了，下一次epoll_wait之前再按每个fd最终的状态统一提交，
+// 一轮中对同一个fd的多次修改(比如回调中先enable_writing又disable_writing)最多只有一次epoll_ctl，
+// 最终和内核中已经注册的事件相同时一次也没有。
+// remove_channel仍然立即生效：调用者随后就会close(fd)，fd可能马上被新的Channel复用。
 class EPollPoller : public Poller {
 public:
   EPollPoller(EventLoop *);
   ~EPollPoller() override;
 
-  Timestamp poll(int timeout_ms, std::vector<Channel *> *active_channels) override;
+  Timestamp poll(int64_t timeout_us, std::vector<Channel *> *active_channels) override;
 
   void update_channel(Channel *) override;
   void remove_channel(Channel *) override;
 
+  const char *name() const override { return "epoll"; }
+  bool        supports_edge_triggered() const override { return true; }
+  // 内核5.11+有epoll_pwait2时超时是纳秒精度，否则epoll_wait只能精确到毫秒
+  bool        supports_precise_timeout() const override { return _has_epoll_pwait2; }
+
 private:
   static const int   kInitEventListSize = 16;
   static const char *operation_to_string(int op);
   void               fill_active_channels(int num_events, std::vector<Channel *> *active_channels) const;
+  void               apply_pending_updates();
+  int                wait(int64_t timeout_us);
   void               update(int op, Channel *ch);
 
+  // 按fd索引，记录内核中注册的事件和本轮还没有提交的修改次数
+  struct Interest {
+    uint32_t events = 0;
+    int      pending_updates = 0;
+  };
+
   int                             _epollfd;
+  bool                            _has_epoll_pwait2;
   std::vector<struct epoll_event> _events;
+  std::vector<Interest>           _interests;
+  std::vector<int>                _pending_fds; // 本轮修改过关注事件的fd，按第一次修改的顺序
 };
 
 } // namespace muduo
@@ -1,11 +1,18 @@
 #include "event_loop.h"
 
 #include <glog/logging.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/eventfd.h>
+#include <sys/prctl.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "channel.h"
+#include "chunk_pool.h"
 #include "current_thread.h"
+#include "io_uring_poller.h"
 #include "poller.h"
 #include "timer.h"
 #include "timer_queue.h"
@@ -22,15 +29,45 @@ using namespace muduo;
 
 thread_local EventLoop *t_LoopInThisThread = nullptr;
 
-EventLoop::EventLoop()
-    : _poller(Poller::new_default_poller(this))
+namespace {
+// poller的超时不够精确，或者环境变量MUDUO_TIMER=timerfd时，定时器用timerfd触发
+bool use_timerfd(const Poller *poller) {
+  const char *env = ::getenv("MUDUO_TIMER");
+  return !poller->supports_precise_timeout() || (env && strcmp(env, "timerfd") == 0);
+}
+
+// 环境变量MUDUO_TIMER_QUEUE=wheel时用时间轮组织定时器，默认用std::set
+bool use_timing_wheel() {
+  const char *env = ::getenv("MUDUO_TIMER_QUEUE");
+  return env && strcmp(env, "wheel") == 0;
+}
+} // namespace
+
+EventLoop::EventLoop(PollerBackend backend)
+    : _poller(Poller::new_poller(this, backend))
     , _threadid(tid())
+    , _pthread(pthread_self())
     , _iteration(0)
     , _looping(false)
     , _quit(false)
     , _wakeupfd(create_eventfd())
     , _wakeup_channel(new Channel(this, _wakeupfd))
-    , _timer_queue(new TimerQueue(this)) {
+    , _calling_pending_functors(false)
+    , _wakeup_pending(true)
+    , _wakeups(0)
+    , _suppressed_wakeups(0)
+    , _busy_poll_max_us(0)
+    , _busy_poll_budget_us(0)
+    , _busy_poll_hits(0)
+    , _busy_poll_misses(0)
+    , _functor_budget_tasks(0)
+    , _functor_budget_us(0)
+    , _channel_budget(0)
+    , _channel_cursor(0)
+    , _timer_queue(new TimerQueue(this, use_timerfd(_poller.get()), use_timing_wheel()))
+    , _stats_enabled(false)
+    , _heartbeat_enabled(false)
+    , _chunk_pool(std::make_shared<ChunkPool>()) {
   // 如果当前线程的EventLoop已经存在，严重错误，退出程序
   if (t_LoopInThisThread) {
     LOG(FATAL) << "another eventloop=" << t_LoopInThisThread << " exists in current thread=" << tid();
@@ -38,7 +75,13 @@ EventLoop::EventLoop()
     t_LoopInThisThread = this;
   }
   _wakeup_channel->set_read_callback(std::bind(&EventLoop::handle_read, this));
+  _wakeup_channel->set_priority(Channel::kHighPriority);
   _wakeup_channel->enable_reading();
+  if (!_timer_queue->uses_timerfd()) {
+    // poll的超时会按线程的timer slack(默认50us)推迟，timerfd不会，调到最小让两种方式精度一致
+    // 只影响loop线程自己
+    ::prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+  }
   DLOG(INFO) << "create an event_loop=" << this << " in thread=" << _threadid;
 }
 
@@ -71,21 +114,134 @@ void EventLoop::loop() {
   while (!_quit) {
     DLOG(INFO) << "event_loop[" << this << "] one round of loopping ...";
     _active_channels.clear();
-    _poll_return_ts = _poller->poll(10000 /*ms*/, &_active_channels);
+    const bool stats_enabled = _stats_enabled.load(std::memory_order_relaxed);
+    const bool heartbeat_enabled = _heartbeat_enabled.load(std::memory_order_relaxed);
+    int64_t    poll_start_ns = stats_enabled ? monotonic_ns() : 0;
+    if (heartbeat_enabled) {
+      _heartbeat.busy_since_ns.store(0, std::memory_order_relaxed);
+    }
+    if (!busy_poll()) {
+      // 准备睡眠：从这里开始，第一个跨线程提交任务的线程负责写eventfd唤醒
+      // 先清标志再检查队列，保证清标志之前提交的任务一定能在这里被看到，不会丢失唤醒
+      _wakeup_pending = false;
+      _poll_return_ts = _poller->poll(poll_timeout_us(), &_active_channels);
+      // 醒着的时候提交的任务都会在本轮的call_pending_functors中处理，不需要再唤醒
+      _wakeup_pending = true;
+    }
+    int64_t dispatch_start_ns = stats_enabled || heartbeat_enabled ? monotonic_ns() : 0;
+    if (heartbeat_enabled) {
+      _heartbeat.busy_since_ns.store(dispatch_start_ns, std::memory_order_relaxed);
+    }
     _event_handling = true;
-    // TODO: sort channel by priority
-    for (auto it = _active_channels.begin(); it != _active_channels.end(); ++it) {
-      _current_active_channel = *it;
-      _current_active_channel->handle_event(_poll_return_ts);
+    if (!_timer_queue->uses_timerfd()) {
+      _timer_queue->handle_expired(_poll_return_ts);
     }
-    _current_active_channel = nullptr;
+    dispatch_active_channels(heartbeat_enabled);
     _event_handling = false;
-    call_pending_functors();
+    int64_t functors_start_ns = stats_enabled ? monotonic_ns() : 0;
+    size_t  num_functors = call_pending_functors(heartbeat_enabled);
+    if (stats_enabled) {
+      int64_t end_ns = monotonic_ns();
+      _stats.poll_ns.record(dispatch_start_ns - poll_start_ns);
+      _stats.active_channels.record(_active_channels.size());
+      _stats.dispatch_ns.record(functors_start_ns - dispatch_start_ns);
+      _stats.functors_ns.record(end_ns - functors_start_ns);
+      _stats.functors_count.record(num_functors);
+    }
+    _iteration.store(_iteration.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
   }
   LOG(INFO) << "event_loop[" << this << "] stopped looping.";
   _looping = false;
 }
 
+// 按优先级分趟处理活动Channel，避免排序
+// 先用一趟扫描记下出现了哪些优先级，绝大多数情况下只有一种，直接按poll返回的顺序处理
+// 设置了channel预算时，高优先级的channel总是全部处理，其余的最多处理预算个，
+// 剩下的不处理，水平触发下一次poll会再次返回它们；每轮从上次停下的位置开始，避免排在后面的饿死
+// 边沿触发的channel不会被再次返回，所以和高优先级一样不受预算限制
+void EventLoop::dispatch_active_channels(bool heartbeat_enabled) {
+  const size_t n = _active_channels.size();
+  size_t       budget = _channel_budget.load(std::memory_order_relaxed);
+  if (budget == 0 || budget > n) budget = n;
+  const size_t start = budget < n ? _channel_cursor % n : 0;
+  size_t       dispatched = 0;
+
+  unsigned present = 0;
+  for (Channel *ch : _active_channels) {
+    present |= 1u << ch->priority();
+  }
+  for (int priority = 0; priority < Channel::kNumPriorities; ++priority) {
+    if (!(present & (1u << priority))) continue;
+    const bool only_this_priority = present == (1u << priority);
+    const bool budgeted = priority != Channel::kHighPriority;
+    for (size_t i = 0; i < n; ++i) {
+      size_t idx = start + i;
+      if (idx >= n) idx -= n;
+      Channel *ch = _active_channels[ idx ];
+      if (!only_this_priority && ch->priority() != priority) continue;
+      const bool edge_triggered = ch->edge_triggered();
+      if (budgeted && !edge_triggered && dispatched >= budget) continue;
+      _current_active_channel = ch;
+      if (heartbeat_enabled) {
+        _heartbeat.fd.store(ch->fd(), std::memory_order_relaxed);
+      }
+      ch->handle_event(_poll_return_ts);
+      if (budgeted && !edge_triggered) ++dispatched;
+    }
+  }
+  if (budget < n) {
+    _channel_cursor = start + budget;
+  }
+  _current_active_channel = nullptr;
+  if (heartbeat_enabled) {
+    _heartbeat.fd.store(-1, std::memory_order_relaxed);
+  }
+}
+
+// 有pending functors时不等待；定时器用poll超时触发时等到最早的定时器到期，否则一直等到有事件
+int64_t EventLoop::poll_timeout_us() const {
+  if (has_pending_work()) return 0;
+  if (_timer_queue->uses_timerfd()) return -1;
+  Timestamp next = _timer_queue->next_expiration();
+  if (!next.valid()) return -1;
+  Timestamp now = Timestamp::now();
+  return now < next ? next - now : 0;
+}
+
+// 以0超时反复poll，直到有事件、有pending functors或者自旋预算用完
+// 自旋期间loop算作醒着，其他线程提交任务不会写eventfd，所以这里要自己检查队列
+// 自旋命中说明负载高，预算翻倍；落空说明比较空闲，预算减半，最少保留上限的1/32
+// @return: 是否在自旋中等到了事件或者任务，false表示需要阻塞poll
+bool EventLoop::busy_poll() {
+  const int64_t max_spin_us = _busy_poll_max_us.load(std::memory_order_relaxed);
+  if (max_spin_us <= 0) {
+    return false;
+  }
+  int64_t budget_us = _busy_poll_budget_us.load(std::memory_order_relaxed);
+  budget_us = std::min(std::max(budget_us, std::max<int64_t>(max_spin_us / 32, 1)), max_spin_us);
+  Timestamp start;
+  do {
+    _poll_return_ts = _poller->poll(0, &_active_channels);
+    if (!_active_channels.empty() || has_pending_work() || timer_expired(_poll_return_ts)) {
+      _busy_poll_hits.fetch_add(1, std::memory_order_relaxed);
+      _busy_poll_budget_us.store(std::min(budget_us * 2, max_spin_us), std::memory_order_relaxed);
+      return true;
+    }
+    if (!start.valid()) {
+      start = _poll_return_ts;
+    }
+  } while (!_quit && _poll_return_ts.ms_since_epoch() - start.ms_since_epoch() < static_cast<uint64_t>(budget_us));
+  _busy_poll_misses.fetch_add(1, std::memory_order_relaxed);
+  _busy_poll_budget_us.store(budget_us / 2, std::memory_order_relaxed);
+  return false;
+}
+
+// 可以在任意线程调用，max_spin_us <= 0 表示关闭busy poll
+void EventLoop::set_busy_poll(int64_t max_spin_us) {
+  _busy_poll_max_us.store(std::max<int64_t>(max_spin_us, 0), std::memory_order_relaxed);
+  _busy_poll_budget_us.store(std::max<int64_t>(max_spin_us, 0), std::memory_order_relaxed);
+}
+
 // 可以在非I/O线程调用
 void EventLoop::quit() {
   _quit = true;
@@ -98,21 +254,81 @@ void EventLoop::quit() {
   LOG(INFO) << "event_loop[" << this << "] asked to quit.";
 }
 
-void EventLoop::call_pending_functors() {
-  std::vector<std::function<void()>> functors;
+// 一次性摘走当前所有的pending functors，执行期间新提交的留到下一轮
+// 设置了预算时，超出预算的functor按原有顺序留到下一轮，排在新提交的之前，保持FIFO
+// @return: 执行的functor个数
+size_t EventLoop::call_pending_functors(bool heartbeat_enabled) {
   _calling_pending_functors = true;
-  {
-    std::lock_guard<std::mutex> gd(_mutex);
-    functors.swap(_pending_functors);
+  auto functors = std::move(_carried_functors);
+  functors.append(_pending_functors.take_all());
+
+  size_t        max_tasks = _functor_budget_tasks.load(std::memory_order_relaxed);
+  const int64_t max_ns = _functor_budget_us.load(std::memory_order_relaxed) * 1000;
+  const int64_t deadline_ns = max_ns > 0 ? monotonic_ns() + max_ns : 0;
+  if (max_tasks == 0) max_tasks = functors.size();
+
+  size_t n = 0;
+  for (; !functors.empty() && n < max_tasks; functors.pop_front()) {
+    // 至少执行一个，保证总能前进
+    if (deadline_ns && n > 0 && monotonic_ns() >= deadline_ns) break;
+    if (heartbeat_enabled) {
+      _heartbeat.functor.store(&functors.front().target_type(), std::memory_order_relaxed);
+    }
+    functors.front()();
+    ++n;
   }
-  for (const auto &func : functors) {
-    func();
+  if (heartbeat_enabled) {
+    _heartbeat.functor.store(nullptr, std::memory_order_relaxed);
   }
+  _carried_functors = std::move(functors);
   _calling_pending_functors = false;
+  return n;
 }
 
+const char *EventLoop::poller_name() const { return _poller->name(); }
+
+bool EventLoop::supports_edge_triggered() const { return _poller->supports_edge_triggered(); }
+
+bool EventLoop::uses_timerfd() const { return _timer_queue->uses_timerfd(); }
+
+const char *EventLoop::timer_queue_name() const { return _timer_queue->name(); }
+
+size_t EventLoop::timer_count() const {
+  assert_in_loop_thread();
+  return _timer_queue->size();
+}
+
+// 定时器用poll超时触发时，是否有定时器已经到期
+bool EventLoop::timer_expired(Timestamp now) const {
+  if (_timer_queue->uses_timerfd()) return false;
+  return _timer_queue->has_expired(now);
+}
+
+int64_t EventLoop::poller_syscalls() const {
+  assert_in_loop_thread();
+  return _poller->syscalls();
+}
+
+int64_t EventLoop::poller_elided_updates() const {
+  assert_in_loop_thread();
+  return _poller->elided_updates();
+}
+
+IoUringPoller *EventLoop::io_uring_poller() const {
+  assert_in_loop_thread();
+  return dynamic_cast<IoUringPoller *>(_poller.get());
+}
+
+void EventLoop::set_functor_budget(size_t max_tasks, int64_t max_us) {
+  _functor_budget_tasks.store(max_tasks, std::memory_order_relaxed);
+  _functor_budget_us.store(std::max<int64_t>(max_us, 0), std::memory_order_relaxed);
+}
+
+// 只能在loop线程中调用
+bool EventLoop::has_pending_work() const { return !_carried_functors.empty() || !_pending_functors.empty(); }
+
 // TODO: 这些func会有多及时被调用？
-void EventLoop::run_in_loop(std::function<void()> func) {
+void EventLoop::run_in_loop(Functor func) {
   if (is_in_loop_thread()) {
     func();
   } else {
@@ -120,22 +336,40 @@ void EventLoop::run_in_loop(std::function<void()> func) {
   }
 }
 
-void EventLoop::queue_in_loop(std::function<void()> func) {
-  {
-    std::lock_guard<std::mutex> guard(_mutex);
-    _pending_functors.push_back(std::move(func));
-  }
-  // TODO: What to do with _calling_pending_functors ?
+void EventLoop::queue_in_loop(Functor func) {
+  _pending_functors.push(std::move(func));
+  wakeup_if_needed(1);
+}
+
+void EventLoop::queue_batch_in_loop(FunctorBatch batch) {
+  size_t n = batch.size();
+  if (n == 0) return;
+  _pending_functors.push_batch(std::move(batch));
+  wakeup_if_needed(n);
+}
+
+// @n: 本次提交的functor个数，用于统计被省掉的唤醒
+void EventLoop::wakeup_if_needed(size_t n) {
   // 为了让func被及时的调用
-  // 如果I/O线程阻塞在poll上，那么需要立刻唤醒
-  // 如果I/O线程已经处理完了epoll的事件，正在调用pending functors，为什么需要唤醒？唤醒如何起作用？
-  // 后一种情况下，func可能会被挂起很久！
-  if (!is_in_loop_thread() || _calling_pending_functors) {
+  // 如果I/O线程阻塞在poll上，那么需要立刻唤醒，但只需要第一个提交者唤醒一次
+  // 如果I/O线程醒着(处理事件或者pending functors)，它在下一次poll之前会检查队列，不需要唤醒
+  // loop线程自己提交的func也是同理，包括在pending functors中提交的
+  if (is_in_loop_thread()) {
+    if (_calling_pending_functors) {
+      _suppressed_wakeups.fetch_add(n, std::memory_order_relaxed);
+    }
+    return;
+  }
+  if (_wakeup_pending.exchange(true)) {
+    _suppressed_wakeups.fetch_add(n, std::memory_order_relaxed);
+  } else {
     wakeup();
+    _suppressed_wakeups.fetch_add(n - 1, std::memory_order_relaxed);
   }
 }
 
 void EventLoop::wakeup() {
+  _wakeups.fetch_add(1, std::memory_order_relaxed);
   uint64_t one = 1;
   ssize_t  n = write(_wakeupfd, &one, sizeof one);
   if (n != sizeof one) {
@@ -179,18 +413,36 @@ void EventLoop::update_channel(Channel *ch) {
   _poller->update_channel(ch);
 }
 
-TimerId EventLoop::run_at(Timestamp time, std::function<void()> cb) {
+TimerId EventLoop::run_at(Timestamp time, TimerCallback cb) {
   return _timer_queue->add_timer(time, 0.0, std::move(cb));
 }
 
-TimerId EventLoop::run_after(double delay, std::function<void()> cb) {
+TimerId EventLoop::run_after(double delay, TimerCallback cb) {
   auto time = Timestamp::now() + delay;
-  return run_at(time, cb);
+  return run_at(time, std::move(cb));
 }
 
-TimerId EventLoop::run_every(double interval, std::function<void()> cb) {
+TimerId EventLoop::run_every(double interval, TimerCallback cb) {
   auto time = Timestamp::now() + interval;
   return _timer_queue->add_timer(time, interval, std::move(cb));
 }
 
+TimerId EventLoop::run_at(Timestamp time, double slack, TimerCallback cb) {
+  return _timer_queue->add_timer(time, 0.0, std::move(cb), slack);
+}
+
+TimerId EventLoop::run_after(double delay, double slack, TimerCallback cb) {
+  auto time = Timestamp::now() + delay;
+  return run_at(time, slack, std::move(cb));
+}
+
+TimerId EventLoop::run_every(double interval, double slack, TimerCallback cb) {
+  auto time = Timestamp::now() + interval;
+  return _timer_queue->add_timer(time, interval, std::move(cb), slack);
+}
+
+int64_t EventLoop::timer_wakeups() const { return _timer_queue->wakeups(); }
+
+int64_t EventLoop::saved_timer_wakeups() const { return _timer_queue->saved_wakeups(); }
+
 void EventLoop::cancel(TimerId timerid) { return _timer_queue->cancel(timerid); }
@@ -1,24 +1,36 @@
 #pragma once
 
+#include <pthread.h>
+
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
 #include <vector>
 
+#include "callbacks.h"
+#include "loop_stats.h"
+#include "mpsc_queue.h"
 #include "timer.h"
 #include "timestamp.h"
 
 namespace muduo {
 
 class Channel;
+class ChunkPool;
+class IoUringPoller;
 class Poller;
 class TimerQueue;
 
+// Poller的实现，kDefault按环境变量MUDUO_POLLER选择(epoll或io_uring)，默认epoll
+// io_uring不可用(内核太老或者被禁用)时退回到epoll
+enum class PollerBackend { kDefault, kEpoll, kIoUring };
+
 // 事件循环：one loop per thread 的实现
 class EventLoop {
+  friend class TimerQueue;
+
 public:
-  EventLoop();
+  explicit EventLoop(PollerBackend backend = PollerBackend::kDefault);
   ~EventLoop();
 
   // 阻止拷贝
@@ -30,22 +42,89 @@ public:
   void loop();
   void quit();
 
+  // busy poll模式：阻塞在poll之前，先以0超时自旋最多max_spin_us微秒，用CPU换取更低的延迟
+  // 实际的自旋时长会随负载自适应调整，max_spin_us <= 0 表示关闭(默认)
+  void    set_busy_poll(int64_t max_spin_us);
+  int64_t busy_poll_budget_us() const { return _busy_poll_budget_us.load(std::memory_order_relaxed); }
+  int64_t busy_poll_hits() const { return _busy_poll_hits.load(std::memory_order_relaxed); }
+  int64_t busy_poll_misses() const { return _busy_poll_misses.load(std::memory_order_relaxed); }
+
+  // 每轮最多执行max_tasks个pending functor，或者最多执行max_us微秒(至少执行一个)，0表示不限制
+  // 没执行完的按原有顺序留到下一轮，且下一轮poll不会阻塞
+  // 可以在任意线程调用
+  void set_functor_budget(size_t max_tasks, int64_t max_us);
+  // 每轮最多处理max_channels个非高优先级的活动Channel，然后就去执行pending functors，0表示不限制
+  void set_channel_budget(size_t max_channels) { _channel_budget.store(max_channels, std::memory_order_relaxed); }
+
+  // 本轮poll返回的时间，每次poll返回时刷新一次，在loop线程中调用时没有系统调用
+  // 处理事件期间时间不会前进，需要精确时间的地方(比如计算定时器的延迟)仍然用Timestamp::now()
+  // 在其他线程中调用时退化为Timestamp::now()
+  Timestamp now() const { return is_in_loop_thread() ? _poll_return_ts : Timestamp::now(); }
+
+  // 只能在loop线程中调用
+  const char *poller_name() const;
+  // 为false时Channel只能使用水平触发，见Channel::set_edge_triggered
+  bool        supports_edge_triggered() const;
+  // 定时器是否用timerfd触发，false表示直接用poll的超时触发，见TimerQueue
+  bool        uses_timerfd() const;
+  // 定时器的组织方式，"set"或者"wheel"，见TimerQueue
+  const char *timer_queue_name() const;
+  size_t      timer_count() const;
+  int64_t     poller_syscalls() const;
+  int64_t     poller_elided_updates() const;
+  // poller是io_uring时返回它，用于完成模式的I/O；否则返回nullptr
+  IoUringPoller *io_uring_poller() const;
+
+  // 已经完成的循环轮数，可在任意线程读取
+  int64_t iteration() const { return _iteration.load(std::memory_order_relaxed); }
+
+  // 打开后每轮循环记录poll/dispatch/functors/timers的耗时直方图，默认关闭
+  // stats()可以在任意线程读取快照，用来判断loop是饱和还是空闲
+  void                  enable_stats(bool on) { _stats_enabled.store(on, std::memory_order_relaxed); }
+  bool                  stats_enabled() const { return _stats_enabled.load(std::memory_order_relaxed); }
+  const EventLoopStats &stats() const { return _stats; }
+
+  // 打开后每轮循环发布心跳(本轮开始时间、正在处理的fd或functor)，由LoopWatchdog打开
+  void                 enable_heartbeat(bool on) { _heartbeat_enabled.store(on, std::memory_order_relaxed); }
+  const LoopHeartbeat &heartbeat() const { return _heartbeat; }
+  pthread_t            pthread_handle() const { return _pthread; }
+
+  // 这个loop上的连接共用的缓冲区chunk池，连接持有一份shared_ptr，见ChunkPool
+  const std::shared_ptr<ChunkPool> &chunk_pool() const { return _chunk_pool; }
+
   // bellow functions are safe to call from other threads
-  TimerId run_at(Timestamp time, std::function<void()> cb);
-  TimerId run_after(double delay, std::function<void()> cb);
-  TimerId run_every(double interval, std::function<void()> cb);
+  TimerId run_at(Timestamp time, TimerCallback cb);
+  TimerId run_after(double delay, TimerCallback cb);
+  TimerId run_every(double interval, TimerCallback cb);
+  // 允许晚slack秒执行：heartbeat、空闲检查、重试之类不需要精确时间的定时器，
+  // 时间窗口重叠的定时器合并成一次唤醒，见TimerQueue
+  TimerId run_at(Timestamp time, double slack, TimerCallback cb);
+  TimerId run_after(double delay, double slack, TimerCallback cb);
+  TimerId run_every(double interval, double slack, TimerCallback cb);
   void    cancel(TimerId timerid);
 
+  // 执行到期定时器的次数，以及有slack的定时器合并到其他唤醒中、省掉的唤醒次数，可在任意线程读取
+  int64_t timer_wakeups() const;
+  int64_t saved_timer_wakeups() const;
+
   // if assert failed, abort the program.
   void assert_in_loop_thread() const;
   bool is_in_loop_thread() const;
 
-  void run_in_loop(std::function<void()> func);
-  void queue_in_loop(std::function<void()> func);
+  using FunctorBatch = MpscQueue<Functor>::Batch;
+
+  void run_in_loop(Functor func);
+  void queue_in_loop(Functor func);
+  // 一次提交一批functor：只入队一次，最多唤醒一次，批内按顺序执行
+  void queue_batch_in_loop(FunctorBatch batch);
 
   void wakeup();
   void handle_read();
 
+  // 写eventfd的次数，以及被合并掉的唤醒次数，可在任意线程读取
+  int64_t wakeup_count() const { return _wakeups.load(std::memory_order_relaxed); }
+  int64_t suppressed_wakeup_count() const { return _suppressed_wakeups.load(std::memory_order_relaxed); }
+
   static EventLoop *event_loop_of_current_thread();
 
   bool has_channel(Channel *);
@@ -53,13 +132,20 @@ public:
   void update_channel(Channel *);
 
 private:
-  void call_pending_functors();
+  bool    busy_poll();
+  int64_t poll_timeout_us() const;
+  bool    timer_expired(Timestamp now) const;
+  void    dispatch_active_channels(bool heartbeat_enabled);
+  size_t  call_pending_functors(bool heartbeat_enabled);
+  bool    has_pending_work() const;
+  void    wakeup_if_needed(size_t n);
   // 一个EventLoop有一个Poller，当前只实现了epoll
   std::unique_ptr<Poller> _poller;
 
   // 创建该EventLoop对象的线程ID，is_in_loop_thread用到
-  const pid_t _threadid;
-  int64_t     _iteration;
+  const pid_t          _threadid;
+  const pthread_t      _pthread; // 用于LoopWatchdog向loop线程发信号抓取调用栈
+  std::atomic<int64_t> _iteration;
 
   // 是否处于事件循环当中
   std::atomic<bool> _looping;
@@ -79,14 +165,39 @@ private:
   // 当前正在处理的活动Channel
   Channel *_current_active_channel;
 
-  int                                _wakeupfd;
-  Channel                           *_wakeup_channel;
-  mutable std::mutex                 _mutex; // protects _pending_functors
-  bool                               _calling_pending_functors;
-  std::vector<std::function<void()>> _pending_functors;
+  int      _wakeupfd;
+  Channel *_wakeup_channel;
+  bool     _calling_pending_functors;
+  // 其他线程通过queue_in_loop提交的任务，无锁的多生产者单消费者队列
+  MpscQueue<Functor> _pending_functors;
+  // 上一轮因为预算没执行完的functor，比_pending_functors中的都早
+  MpscQueue<Functor>::Batch _carried_functors;
+  // loop醒着，或者已经有线程写过eventfd，此时再提交任务不需要唤醒
+  std::atomic<bool>    _wakeup_pending;
+  std::atomic<int64_t> _wakeups;
+  std::atomic<int64_t> _suppressed_wakeups;
+
+  // busy poll的配置和统计
+  std::atomic<int64_t> _busy_poll_max_us;
+  std::atomic<int64_t> _busy_poll_budget_us; // 当前的自旋预算
+  std::atomic<int64_t> _busy_poll_hits;      // 自旋期间等到了事件
+  std::atomic<int64_t> _busy_poll_misses;    // 自旋落空，退回阻塞poll
+
+  // 每轮的functor和channel预算，0表示不限制
+  std::atomic<size_t>  _functor_budget_tasks;
+  std::atomic<int64_t> _functor_budget_us;
+  std::atomic<size_t>  _channel_budget;
+  size_t               _channel_cursor; // 预算不够时下一轮从这里开始处理活动channel
 
   // 处理定时器事件
   std::unique_ptr<TimerQueue> _timer_queue;
+
+  std::atomic<bool> _stats_enabled;
+  EventLoopStats    _stats;
+  std::atomic<bool> _heartbeat_enabled;
+  LoopHeartbeat     _heartbeat;
+
+  std::shared_ptr<ChunkPool> _chunk_pool;
 };
 
 } // namespace muduo
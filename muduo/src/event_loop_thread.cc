@@ -9,11 +9,11 @@ using namespace muduo;
 EventLoopThread::EventLoopThread(const ThreadInitCallback &cb, const std::string &name)
     : _loop(nullptr)
     , _exiting(false)
-    , _thread(std::bind(&EventLoopThread::thread_func, this))
     , _mutex()
     , _cond()
     , _callback(cb)
-    , _name(name) {
+    , _name(name)
+    , _thread(std::bind(&EventLoopThread::thread_func, this)) {
   DLOG(INFO) << "constructed an EventLoopThread, name[" << _name << "], this[" << this << "], thread["
              << _thread.get_id() << "]";
 }
@@ -28,11 +28,12 @@ private:
   void                    thread_func();
   EventLoop              *_loop; // guarded by mutex
   bool                    _exiting;
-  std::thread             _thread;
   std::mutex              _mutex;
   std::condition_variable _cond; // guarded by _mutex
   ThreadInitCallback      _callback;
   std::string             _name;
+  // 线程一创建就开始运行thread_func，要用到上面的成员，所以放在最后构造
+  std::thread _thread;
 };
 
 } // namespace muduo
\ No newline at end of file
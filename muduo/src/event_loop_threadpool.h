@@ -1,14 +1,18 @@
 #pragma once
 
 #include <boost/noncopyable.hpp>
+#include <exception>
 #include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "muduo/src/event_loop.h"
+
 namespace muduo {
 
-class EventLoop;
 class EventLoopThread;
 
 class EventLoopThreadPool : public boost::noncopyable {
@@ -27,7 +31,28 @@ public:
   bool                     started() const { return _started; }
   const std::string       &name() const { return _name; }
 
+  // 在每个loop中执行一次f(loop)，不等待执行完成，f会被拷贝到每个loop
+  // 和get_all_loops一样只能在base loop线程中调用
+  template <typename F>
+  void broadcast(const F &f);
+
+  // 在每个loop中执行一次f(loop)，等待全部执行完成，按get_all_loops的顺序返回结果
+  // 各个loop并行执行；f在当前线程(base loop)中的那一份直接执行
+  // f抛出的异常在所有loop都执行完之后在调用线程中重新抛出，有多个时抛出按loop顺序的第一个
+  // 不能在池中的loop退出期间调用：已经退出的loop不再执行f，调用者会一直等待
+  template <typename F>
+  std::vector<std::invoke_result_t<F, EventLoop *>> gather(const F &f);
+
 private:
+  template <typename F, typename Result>
+  static void fulfill(std::promise<Result> *promise, const F &f, EventLoop *loop) {
+    try {
+      promise->set_value(f(loop));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  }
+
   EventLoop                                    *_base_loop;
   std::string                                   _name;
   bool                                          _started;
@@ -37,4 +62,40 @@ private:
   std::vector<EventLoop *>                      _loops;
 };
 
+template <typename F>
+void EventLoopThreadPool::broadcast(const F &f) {
+  for (EventLoop *loop : get_all_loops()) {
+    loop->run_in_loop([ f, loop ] { f(loop); });
+  }
+}
+
+template <typename F>
+std::vector<std::invoke_result_t<F, EventLoop *>> EventLoopThreadPool::gather(const F &f) {
+  using Result = std::invoke_result_t<F, EventLoop *>;
+  static_assert(!std::is_void<Result>::value, "gather needs a result, use broadcast instead");
+  auto                              loops = get_all_loops();
+  std::vector<std::promise<Result>> promises(loops.size());
+  std::vector<std::future<Result>>  futures;
+  futures.reserve(loops.size());
+  for (auto &promise : promises) futures.push_back(promise.get_future());
+  // 先把任务都分发出去再等待，其余loop并行执行
+  for (size_t i = 0; i < loops.size(); ++i) {
+    EventLoop *loop = loops[ i ];
+    if (loop->is_in_loop_thread()) continue;
+    std::promise<Result> *promise = &promises[ i ];
+    loop->queue_in_loop([ f, loop, promise ] { fulfill(promise, f, loop); });
+  }
+  for (size_t i = 0; i < loops.size(); ++i) {
+    if (loops[ i ]->is_in_loop_thread()) fulfill(&promises[ i ], f, loops[ i ]);
+  }
+  // 其他loop还持有promises中的指针，全部完成之后才能抛出异常、离开这个函数
+  for (auto &future : futures) future.wait();
+  std::vector<Result> results;
+  results.reserve(loops.size());
+  for (auto &future : futures) {
+    results.push_back(future.get());
+  }
+  return results;
+}
+
 } // namespace muduo
\ No newline at end of file
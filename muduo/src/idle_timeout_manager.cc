@@ -0,0 +1,128 @@
+#include "idle_timeout_manager.h"
+
+#include <assert.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+
+using namespace muduo;
+
+namespace {
+// 每秒的检查晚一点没有关系，on_tick按实际时间计算处理到哪一秒，允许和附近的定时器合并唤醒
+const double kTickSlack = 0.1;
+} // namespace
+
+IdleTimeoutManager::IdleTimeoutManager(EventLoop *loop, int timeout_seconds)
+    : _loop(loop)
+    , _timeout_seconds(timeout_seconds)
+    , _timeout_us(timeout_seconds * kTickUs)
+    , _origin_us(Timestamp::now().ms_since_epoch())
+    , _now_tick(0)
+    , _buckets(timeout_seconds + 2, nullptr)
+    , _size(0)
+    , _expired(0) {
+  assert(timeout_seconds > 0);
+  _timer = _loop->run_every(1.0, kTickSlack, [ this ] { on_tick(); });
+}
+
+// 还在跟踪的连接不再检查，它们之后关闭时也不会再访问这个manager
+IdleTimeoutManager::~IdleTimeoutManager() {
+  _loop->assert_in_loop_thread();
+  _loop->cancel(_timer);
+  for (TcpConnection *&head : _buckets) {
+    while (head) {
+      TcpConnection *conn = head;
+      unlink(conn);
+      conn->_idle_manager = nullptr;
+    }
+  }
+}
+
+void IdleTimeoutManager::add(TcpConnection *conn) {
+  _loop->assert_in_loop_thread();
+  assert(conn->_idle_bucket == -1);
+  conn->_idle_last_active_us = _loop->now().ms_since_epoch();
+  link(conn);
+  ++_size;
+}
+
+void IdleTimeoutManager::remove(TcpConnection *conn) {
+  _loop->assert_in_loop_thread();
+  if (conn->_idle_bucket == -1) return;
+  unlink(conn);
+  --_size;
+}
+
+int64_t IdleTimeoutManager::tick_of(int64_t us) const {
+  if (us <= _origin_us) return 0;
+  return (us - _origin_us + kTickUs - 1) / kTickUs;
+}
+
+// 挂到最后活跃时间加timeout所在的那一秒的桶中，加到链表尾部
+// 到期的秒一定在(_now_tick, _now_tick + timeout + 1]中，桶数是timeout + 2，不会挂到_now_tick所在的桶
+void IdleTimeoutManager::link(TcpConnection *conn) {
+  int64_t tick = std::max(tick_of(conn->_idle_last_active_us + _timeout_us), _now_tick + 1);
+  int     bucket = static_cast<int>(tick % static_cast<int64_t>(_buckets.size()));
+  TcpConnection *&head = _buckets[ bucket ];
+  if (head == nullptr) {
+    conn->_idle_prev = conn->_idle_next = conn;
+    head = conn;
+  } else {
+    TcpConnection *tail = head->_idle_prev;
+    conn->_idle_prev = tail;
+    conn->_idle_next = head;
+    tail->_idle_next = conn;
+    head->_idle_prev = conn;
+  }
+  conn->_idle_bucket = bucket;
+}
+
+void IdleTimeoutManager::unlink(TcpConnection *conn) {
+  TcpConnection *&head = _buckets[ conn->_idle_bucket ];
+  if (conn->_idle_next == conn) {
+    head = nullptr;
+  } else {
+    conn->_idle_prev->_idle_next = conn->_idle_next;
+    conn->_idle_next->_idle_prev = conn->_idle_prev;
+    if (head == conn) head = conn->_idle_next;
+  }
+  conn->_idle_prev = conn->_idle_next = nullptr;
+  conn->_idle_bucket = -1;
+}
+
+// 定时器晚到(loop被卡住、slack)时依次处理中间的每个桶，落后超过一圈时每个桶处理一次就够了
+void IdleTimeoutManager::on_tick() {
+  int64_t now_us = _loop->now().ms_since_epoch();
+  int64_t target = now_us > _origin_us ? (now_us - _origin_us) / kTickUs : 0;
+  if (target <= _now_tick) return;
+  int64_t first = std::max(_now_tick + 1, target - static_cast<int64_t>(_buckets.size()) + 1);
+  _now_tick = target;
+  for (int64_t tick = first; tick <= target; ++tick) {
+    expire_bucket(static_cast<int>(tick % static_cast<int64_t>(_buckets.size())), now_us);
+  }
+}
+
+// 先把整个桶摘下来，重新挂回来的连接不会在这一轮中被再次检查
+// force_close只是放入pending functors，连接在之后的handle_close中才关闭，遍历期间链表不会被修改
+void IdleTimeoutManager::expire_bucket(int bucket, int64_t now_us) {
+  TcpConnection *head = _buckets[ bucket ];
+  if (head == nullptr) return;
+  _buckets[ bucket ] = nullptr;
+  TcpConnection *conn = head;
+  do {
+    TcpConnection *next = conn->_idle_next;
+    conn->_idle_prev = conn->_idle_next = nullptr;
+    conn->_idle_bucket = -1;
+    if (now_us - conn->_idle_last_active_us >= _timeout_us) {
+      --_size;
+      ++_expired;
+      conn->_idle_manager = nullptr;
+      LOG(INFO) << "IdleTimeoutManager close idle connection[" << conn->name() << "], idle "
+                << (now_us - conn->_idle_last_active_us) / 1000 << "ms";
+      conn->force_close();
+    } else {
+      link(conn);
+    }
+    conn = next;
+  } while (conn != head);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boost/noncopyable.hpp>
+#include <vector>
+
+#include "event_loop.h"
+#include "tcp_connection.h"
+#include "timer.h"
+
+namespace muduo {
+
+// 每个loop一个，关闭超过timeout秒没有收到数据的连接
+//
+// 连接按到期的秒挂在timeout+2个桶组成的环上，每个桶是TcpConnection中的侵入式双向链表，
+// 整个管理器只有一个每秒执行一次的定时器，不是每个连接一个定时器。
+// touch只记录最后活跃的时间，不移动链表节点，收到数据时的开销是一次store。
+// 定时器每秒处理一个桶：已经空闲够timeout的连接force_close，其余的按最后活跃时间挂到新的桶中，
+// 每个连接在每个timeout周期内最多被检查一次。
+// 定时器晚到时按实际时间补齐中间的桶，所以连接被关闭时至少空闲了timeout秒，最多再晚一秒多。
+//
+// 除了构造函数都只能在loop线程中调用，也必须在loop线程中析构
+class IdleTimeoutManager : public boost::noncopyable {
+public:
+  IdleTimeoutManager(EventLoop *loop, int timeout_seconds);
+  ~IdleTimeoutManager();
+
+  void add(TcpConnection *conn);
+  // 连接关闭或者已经因为空闲被关闭之后都可以调用
+  void remove(TcpConnection *conn);
+  // 有数据到达，O(1)
+  void touch(TcpConnection *conn) { conn->_idle_last_active_us = _loop->now().ms_since_epoch(); }
+
+  int     timeout_seconds() const { return _timeout_seconds; }
+  size_t  size() const { return _size; }            // 正在跟踪的连接数
+  int64_t expired_count() const { return _expired; } // 因为空闲被关闭的连接数
+
+private:
+  static const int64_t kTickUs = 1000 * 1000;
+
+  int64_t tick_of(int64_t us) const; // 向上取整
+  void    link(TcpConnection *conn);
+  void    unlink(TcpConnection *conn);
+  void    on_tick();
+  void    expire_bucket(int bucket, int64_t now_us);
+
+  EventLoop                   *_loop;
+  const int                    _timeout_seconds;
+  const int64_t                _timeout_us;
+  const int64_t                _origin_us;
+  int64_t                      _now_tick; // 已经处理到的秒
+  std::vector<TcpConnection *> _buckets;  // 每个桶的链表头
+  size_t                       _size;
+  int64_t                      _expired;
+  TimerId                      _timer;
+};
+
+} // namespace muduo
@@ -2,7 +2,7 @@
 
 #include <netinet/in.h>
 
-#include <boost/noncopyable.hpp>
+#include <string>
 #include <string_view>
 
 namespace muduo {
@@ -11,8 +11,8 @@ const struct sockaddr *sockaddr_cast(const struct sockaddr_in6 *addr);
 }
 
 // wrapper of sockaddr_in
-// this is an POD interface class
-class InetAddress : public boost::noncopyable {
+// this is an POD interface class, copyable
+class InetAddress {
 public:
   explicit InetAddress(uint16_t port = 0, bool loop_back_only = false, bool ipv6 = false);
   // @c ip should be "1.2.3.4"
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace muduo {
+
+// 默认的内联缓冲区大小，加上一个ops指针，整个对象正好占一个cache line
+constexpr size_t kDefaultInlineFunctionSize = 56;
+
+template <typename Signature, size_t InlineSize = kDefaultInlineFunctionSize>
+class InlineFunction;
+
+// 只能移动的可调用对象，用来替代reactor核心路径上的std::function
+//
+// std::function在捕获超过两个指针大小时就会在堆上分配，而且要求可拷贝。
+// InlineFunction把不超过InlineSize字节的可调用对象直接放在对象内部，只有超出的才退回到堆上分配，
+// 典型的lambda(捕获this、shared_ptr和几个整数)、std::bind以及std::function本身都能内联存放。
+// 和std::function一样，operator()是const的，但被调用的对象可以是非const的。
+template <typename R, typename... Args, size_t InlineSize>
+class InlineFunction<R(Args...), InlineSize> {
+  struct Ops {
+    R (*invoke)(void *storage, Args &&...args);
+    void (*move)(void *dst, void *src) noexcept; // 把src移动到dst，并析构src
+    void (*destroy)(void *storage) noexcept;
+    bool                  on_heap;
+    const std::type_info *type;
+  };
+
+  template <typename T>
+  static constexpr bool kFitsInline = sizeof(T) <= InlineSize && alignof(T) <= alignof(std::max_align_t) &&
+                                      std::is_nothrow_move_constructible<T>::value;
+
+  template <typename T>
+  struct InlineOps {
+    static R invoke(void *storage, Args &&...args) {
+      return std::invoke(*static_cast<T *>(storage), std::forward<Args>(args)...);
+    }
+    static void move(void *dst, void *src) noexcept {
+      new (dst) T(std::move(*static_cast<T *>(src)));
+      static_cast<T *>(src)->~T();
+    }
+    static void destroy(void *storage) noexcept { static_cast<T *>(storage)->~T(); }
+  };
+
+  template <typename T>
+  struct HeapOps {
+    static R invoke(void *storage, Args &&...args) {
+      return std::invoke(**static_cast<T **>(storage), std::forward<Args>(args)...);
+    }
+    static void move(void *dst, void *src) noexcept { *static_cast<T **>(dst) = *static_cast<T **>(src); }
+    static void destroy(void *storage) noexcept { delete *static_cast<T **>(storage); }
+  };
+
+  template <typename T>
+  static constexpr Ops kInlineOps{&InlineOps<T>::invoke, &InlineOps<T>::move, &InlineOps<T>::destroy, false,
+                                &typeid(T)};
+  template <typename T>
+  static constexpr Ops kHeapOps{&HeapOps<T>::invoke, &HeapOps<T>::move, &HeapOps<T>::destroy, true, &typeid(T)};
+
+  template <typename T>
+  static bool is_null(const T &f) {
+    if constexpr (std::is_pointer<T>::value || std::is_member_pointer<T>::value) {
+      return f == nullptr;
+    } else if constexpr (std::is_same<T, std::function<R(Args...)>>::value) {
+      return !f;
+    } else {
+      (void)f;
+      return false;
+    }
+  }
+
+public:
+  static constexpr size_t kInlineSize = InlineSize;
+
+  InlineFunction() noexcept = default;
+  InlineFunction(std::nullptr_t) noexcept {}
+
+  template <typename F, typename T = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same<T, InlineFunction>::value &&
+                                        std::is_invocable_r<R, T &, Args...>::value>>
+  InlineFunction(F &&f) {
+    if (is_null(f)) return;
+    if constexpr (kFitsInline<T>) {
+      new (&_storage) T(std::forward<F>(f));
+      _ops = &kInlineOps<T>;
+    } else {
+      *reinterpret_cast<T **>(&_storage) = new T(std::forward<F>(f));
+      _ops = &kHeapOps<T>;
+    }
+  }
+
+  InlineFunction(InlineFunction &&other) noexcept { move_from(other); }
+  InlineFunction &operator=(InlineFunction &&other) noexcept {
+    if (this != &other) {
+      reset();
+      move_from(other);
+    }
+    return *this;
+  }
+  InlineFunction &operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  InlineFunction(const InlineFunction &) = delete;
+  InlineFunction &operator=(const InlineFunction &) = delete;
+
+  ~InlineFunction() { reset(); }
+
+  explicit operator bool() const noexcept { return _ops != nullptr; }
+
+  R operator()(Args... args) const {
+    return _ops->invoke(const_cast<void *>(static_cast<const void *>(&_storage)), std::forward<Args>(args)...);
+  }
+
+  // 可调用对象是否放在了内联缓冲区中，没有堆分配
+  bool is_inline() const noexcept { return _ops != nullptr && !_ops->on_heap; }
+
+  // 和std::function::target_type一样，用于诊断时识别是哪个回调
+  const std::type_info &target_type() const noexcept { return _ops ? *_ops->type : typeid(void); }
+
+private:
+  void move_from(InlineFunction &other) noexcept {
+    if (other._ops) {
+      other._ops->move(&_storage, &other._storage);
+      _ops = std::exchange(other._ops, nullptr);
+    }
+  }
+
+  void reset() noexcept {
+    if (_ops) {
+      _ops->destroy(&_storage);
+      _ops = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char _storage[ InlineSize ];
+  const Ops *_ops = nullptr;
+};
+
+} // namespace muduo
@@ -0,0 +1,405 @@
+#include "io_uring_poller.h"
+
+#include <errno.h>
+#include <glog/logging.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/poll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "channel.h"
+
+using namespace muduo;
+
+namespace {
+
+// 一轮中重新提交的请求超过SQ的大小时需要额外的io_uring_enter，所以SQ按上千个活动连接来定
+const unsigned kSqEntries = 4096;
+// 每个Channel最多有一个在等待的POLL_ADD，CQ要能装下一轮中所有Channel同时就绪的情况，
+// 放不下时内核会暂存在溢出链表中(IORING_FEAT_NODROP)，下一次io_uring_enter时再放回CQ
+const unsigned kCqEntries = 16384;
+
+const int      kNew = -1;
+const int      kIdle = 0;
+const uint64_t kIgnoredUserData = 0; // POLL_REMOVE、ASYNC_CANCEL自己的完成事件不需要处理
+// 完成模式的操作的user_data是Op指针加上最高位的标记，用户态指针和fd << 32都不会用到最高位
+const uint64_t kCompletionTag = uint64_t(1) << 63;
+
+// provided buffer: 每个loop一组，共kBufferCount * kBufferSize = 4MB，第一次使用完成模式时才分配
+const uint16_t kBufferGroup = 0;
+const unsigned kBufferCount = 1024;
+const size_t   kBufferSize = 4096;
+
+int io_uring_setup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t argsz) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+  return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+uint64_t make_user_data(int fd, int32_t seq) { return static_cast<uint64_t>(fd) << 32 | static_cast<uint32_t>(seq); }
+
+} // namespace
+
+IoUringPoller *IoUringPoller::create(EventLoop *loop) {
+  io_uring_params params;
+  memset(&params, 0x00, sizeof params);
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = kCqEntries;
+  int ring_fd = io_uring_setup(kSqEntries, &params);
+  if (ring_fd < 0) {
+    LOG(WARNING) << "io_uring_setup failed, errno=" << errno << ", loop=" << loop;
+    return nullptr;
+  }
+  // 需要SQ/CQ共用一次mmap、CQ不丢事件以及io_uring_enter直接带超时参数(5.11+)
+  const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+  if ((params.features & required) != required) {
+    LOG(WARNING) << "io_uring lacks required features, features=" << params.features << ", loop=" << loop;
+    ::close(ring_fd);
+    return nullptr;
+  }
+  IoUringPoller *poller = new IoUringPoller(loop, ring_fd);
+  if (!poller->setup_rings(params)) {
+    delete poller;
+    return nullptr;
+  }
+  return poller;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop, int ring_fd)
+    : Poller(loop)
+    , _ring_fd(ring_fd)
+    , _ring_ptr(MAP_FAILED)
+    , _ring_size(0)
+    , _sqes(static_cast<io_uring_sqe *>(MAP_FAILED))
+    , _sqes_size(0)
+    , _sq_head(nullptr)
+    , _sq_tail(nullptr)
+    , _sq_flags(nullptr)
+    , _sq_mask(0)
+    , _sq_entries(0)
+    , _sq_local_tail(0)
+    , _cq_head(nullptr)
+    , _cq_tail(nullptr)
+    , _cq_mask(0)
+    , _cqes(nullptr)
+    , _next_seq(0)
+    , _completion_channel(new Channel(loop, ring_fd))
+    , _completion_mode_probed(false)
+    , _completion_mode(false) {
+  _completion_channel->set_read_callback(std::bind(&IoUringPoller::handle_completions, this));
+}
+
+IoUringPoller::~IoUringPoller() {
+  // 还在进行中的操作的回调里可能持有TcpConnection，直接释放
+  for (Op *op : _ops) {
+    delete op;
+  }
+  if (_sqes != MAP_FAILED) ::munmap(_sqes, _sqes_size);
+  if (_ring_ptr != MAP_FAILED) ::munmap(_ring_ptr, _ring_size);
+  ::close(_ring_fd);
+}
+
+bool IoUringPoller::setup_rings(const io_uring_params &params) {
+  _ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+  _ring_ptr = ::mmap(nullptr, _ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd,
+                     IORING_OFF_SQ_RING);
+  if (_ring_ptr == MAP_FAILED) {
+    LOG(WARNING) << "mmap io_uring rings failed, errno=" << errno;
+    return false;
+  }
+  _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  _sqes = static_cast<io_uring_sqe *>(
+      ::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES));
+  if (_sqes == MAP_FAILED) {
+    LOG(WARNING) << "mmap io_uring sqes failed, errno=" << errno;
+    return false;
+  }
+
+  char *ring = static_cast<char *>(_ring_ptr);
+  _sq_head = reinterpret_cast<unsigned *>(ring + params.sq_off.head);
+  _sq_tail = reinterpret_cast<unsigned *>(ring + params.sq_off.tail);
+  _sq_flags = reinterpret_cast<unsigned *>(ring + params.sq_off.flags);
+  _sq_mask = *reinterpret_cast<unsigned *>(ring + params.sq_off.ring_mask);
+  _sq_entries = params.sq_entries;
+  _sq_local_tail = *_sq_tail;
+  // SQE按顺序使用，index数组固定为恒等映射
+  unsigned *sq_array = reinterpret_cast<unsigned *>(ring + params.sq_off.array);
+  for (unsigned i = 0; i < _sq_entries; ++i) {
+    sq_array[ i ] = i;
+  }
+  _cq_head = reinterpret_cast<unsigned *>(ring + params.cq_off.head);
+  _cq_tail = reinterpret_cast<unsigned *>(ring + params.cq_off.tail);
+  _cq_mask = *reinterpret_cast<unsigned *>(ring + params.cq_off.ring_mask);
+  _cqes = reinterpret_cast<io_uring_cqe *>(ring + params.cq_off.cqes);
+  return true;
+}
+
+Timestamp IoUringPoller::poll(int64_t timeout_us, std::vector<Channel *> *active_channels) {
+  DLOG(INFO) << "total fd num=" << _channels.size() << " in io_uring[" << this << "]";
+  rearm_fired_channels();
+  unsigned to_submit = sq_pending();
+  bool     cq_ready = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE) != *_cq_head || !_completions.empty();
+  // 没有要提交的请求，CQ中也已经有完成事件(或者上一轮没有分发完的完成事件)时，不需要系统调用
+  if (to_submit > 0 || !cq_ready) {
+    unsigned min_complete = (timeout_us == 0 || cq_ready) ? 0 : 1;
+    int      ret = enter(to_submit, min_complete, timeout_us);
+    if (ret < 0 && errno != EINTR && errno != ETIME && errno != EBUSY) {
+      LOG(WARNING) << "io_uring_enter caused an error_no=" << errno << " in io_uring[" << this << "]";
+    }
+  }
+  auto   now = Timestamp::now();
+  size_t before = active_channels->size();
+  reap(active_channels);
+  // CQ溢出时，把内核暂存的完成事件刷回CQ再取一次
+  if (__atomic_load_n(_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+    enter(0, 0, 0);
+    reap(active_channels);
+  }
+  if (!_completions.empty()) {
+    _completion_channel->set_revents(POLLIN);
+    active_channels->push_back(_completion_channel.get());
+  }
+  if (active_channels->size() > before) {
+    DLOG(INFO) << "num_events=" << active_channels->size() - before << " happend in io_uring[" << this << "]";
+  } else if (timeout_us != 0) {
+    LOG(INFO) << "nothing happend in io_uring[" << this << "]";
+  }
+  return now;
+}
+
+void IoUringPoller::update_channel(Channel *ch) {
+  assert_in_loop_thread();
+  int fd = ch->fd();
+  DLOG(INFO) << "fd=" << fd << ", events=" << ch->events() << ", index=" << ch->index();
+  // oneshot的POLL_ADD重新提交之后总是水平触发
+  assert(!ch->edge_triggered());
+  if (ch->index() == kNew) {
+    _channels.insert(fd, ch);
+    ch->set_index(kIdle);
+  } else {
+    assert(_channels.find(fd) == ch);
+  }
+  // 关注的事件变了，撤销原来的请求，按新的事件重新提交
+  disarm(ch);
+  if (!ch->is_none_event()) {
+    arm(ch);
+  }
+}
+
+void IoUringPoller::remove_channel(Channel *ch) {
+  assert_in_loop_thread();
+  int fd = ch->fd();
+  assert(_channels.find(fd) == ch);
+  assert(ch->is_none_event());
+  assert(ch->index() != kNew);
+  size_t n = _channels.erase(fd);
+  (void)n;
+  assert(n == 1);
+  disarm(ch);
+  ch->set_index(kNew);
+}
+
+// SQ满了就先提交已有的请求，不等待完成事件
+io_uring_sqe *IoUringPoller::get_sqe() {
+  if (_sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries) {
+    enter(sq_pending(), 0, 0);
+  }
+  io_uring_sqe *sqe = &_sqes[ _sq_local_tail & _sq_mask ];
+  memset(sqe, 0x00, sizeof *sqe);
+  ++_sq_local_tail;
+  return sqe;
+}
+
+void IoUringPoller::arm(Channel *ch) {
+  _next_seq = _next_seq == INT32_MAX ? 1 : _next_seq + 1;
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = ch->fd();
+  sqe->poll32_events = static_cast<uint32_t>(ch->events());
+  sqe->user_data = make_user_data(ch->fd(), _next_seq);
+  ch->set_index(_next_seq);
+}
+
+// 撤销channel在等待的请求，被撤销的请求的CQE(-ECANCELED)按序号过期处理
+void IoUringPoller::disarm(Channel *ch) {
+  if (ch->index() <= kIdle) return;
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = make_user_data(ch->fd(), ch->index());
+  sqe->user_data = kIgnoredUserData;
+  ch->set_index(kIdle);
+}
+
+// 上一轮返回了事件的channel，如果没有在回调中被修改或者删除，按原来的事件重新提交
+void IoUringPoller::rearm_fired_channels() {
+  for (int fd : _fired_fds) {
+    Channel *ch = _channels.find(fd);
+    if (!ch) continue;
+    if (ch->index() == kIdle && !ch->is_none_event()) {
+      arm(ch);
+    }
+  }
+  _fired_fds.clear();
+}
+
+unsigned IoUringPoller::sq_pending() const { return _sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE); }
+
+// 发布新的SQE并进入内核，timeout_us < 0 表示一直等待
+int IoUringPoller::enter(unsigned to_submit, unsigned min_complete, int64_t timeout_us) {
+  __atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+  unsigned                      flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+  struct __kernel_timespec      ts;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0x00, sizeof arg);
+  arg.sigmask_sz = _NSIG / 8;
+  if (min_complete > 0 && timeout_us > 0) {
+    ts.tv_sec = timeout_us / Timestamp::kMicroSecondsPerSecond;
+    ts.tv_nsec = static_cast<long long>(timeout_us % Timestamp::kMicroSecondsPerSecond) * 1000;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+  }
+  ++_syscalls;
+  return io_uring_enter(_ring_fd, to_submit, min_complete, flags, &arg, sizeof arg);
+}
+
+void IoUringPoller::reap(std::vector<Channel *> *active_channels) {
+  unsigned head = *_cq_head;
+  unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const io_uring_cqe *cqe = &_cqes[ head & _cq_mask ];
+    if (cqe->user_data == kIgnoredUserData) continue;
+    if (cqe->user_data & kCompletionTag) {
+      Op *op = reinterpret_cast<Op *>(cqe->user_data & ~kCompletionTag);
+      _completions.push_back({op, cqe->res, cqe->flags});
+      continue;
+    }
+    int     fd = static_cast<int>(cqe->user_data >> 32);
+    int32_t seq = static_cast<int32_t>(cqe->user_data & 0xffffffff);
+    Channel *ch = _channels.find(fd);
+    // 已经被撤销或者删除的请求
+    if (!ch || ch->index() != seq) continue;
+    ch->set_index(kIdle);
+    if (cqe->res < 0) {
+      LOG(WARNING) << "io_uring poll for fd=" << fd << " failed, error_no=" << -cqe->res;
+      ch->set_revents(POLLERR);
+    } else {
+      ch->set_revents(cqe->res);
+      _fired_fds.push_back(fd);
+    }
+    active_channels->push_back(ch);
+  }
+  __atomic_store_n(_cq_head, tail, __ATOMIC_RELEASE);
+}
+
+// multishot recv需要6.0+，用同一版本加入的IORING_OP_SEND_ZC探测内核版本
+bool IoUringPoller::enable_completion_mode() {
+  assert_in_loop_thread();
+  if (_completion_mode_probed) return _completion_mode;
+  _completion_mode_probed = true;
+
+  const unsigned kProbeOps = 256;
+  std::vector<char> probe_buf(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op), 0);
+  io_uring_probe   *probe = reinterpret_cast<io_uring_probe *>(probe_buf.data());
+  if (io_uring_register(_ring_fd, IORING_REGISTER_PROBE, probe, kProbeOps) < 0 || probe->last_op < IORING_OP_SEND_ZC ||
+      !(probe->ops[ IORING_OP_SEND_ZC ].flags & IO_URING_OP_SUPPORTED)) {
+    LOG(WARNING) << "io_uring completion mode needs linux 6.0+, io_uring[" << this << "]";
+    return false;
+  }
+
+  _buffers.reset(new char[ kBufferCount * kBufferSize ]);
+  provide_buffers(0, kBufferCount);
+  _completion_mode = true;
+  return true;
+}
+
+uint64_t IoUringPoller::recv_multishot(int fd, CompletionCallback cb) {
+  assert(_completion_mode);
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroup;
+  return add_op(sqe, std::move(cb));
+}
+
+uint64_t IoUringPoller::send(int fd, const void *buf, size_t len, CompletionCallback cb) {
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buf);
+  sqe->len = static_cast<uint32_t>(std::min<size_t>(len, UINT32_MAX));
+  sqe->msg_flags = MSG_NOSIGNAL;
+  return add_op(sqe, std::move(cb));
+}
+
+uint64_t IoUringPoller::sendmsg(int fd, const struct msghdr *msg, CompletionCallback cb) {
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(msg);
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  return add_op(sqe, std::move(cb));
+}
+
+void IoUringPoller::cancel(uint64_t op_id) {
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = op_id;
+  sqe->user_data = kIgnoredUserData;
+}
+
+const char *IoUringPoller::provided_buffer(uint16_t bid) const { return _buffers.get() + bid * kBufferSize; }
+
+void IoUringPoller::recycle_buffer(uint16_t bid) { provide_buffers(bid, 1); }
+
+// 归还的buffer和其他SQE一起在下一次io_uring_enter时提交，在它之前没有可用buffer的recv以-ENOBUFS结束
+void IoUringPoller::provide_buffers(uint16_t first_bid, unsigned count) {
+  io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = static_cast<int>(count);
+  sqe->addr = reinterpret_cast<uint64_t>(_buffers.get() + first_bid * kBufferSize);
+  sqe->len = static_cast<uint32_t>(kBufferSize);
+  sqe->off = first_bid;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = kIgnoredUserData;
+}
+
+uint64_t IoUringPoller::add_op(io_uring_sqe *sqe, CompletionCallback cb) {
+  Op *op = new Op{std::move(cb)};
+  _ops.insert(op);
+  sqe->user_data = reinterpret_cast<uint64_t>(op) | kCompletionTag;
+  return sqe->user_data;
+}
+
+// 作为_completion_channel的读回调，在EventLoop分发活动Channel时执行
+void IoUringPoller::handle_completions() {
+  std::vector<Completion> completions;
+  completions.swap(_completions);
+  for (const Completion &c : completions) {
+    c.op->callback(c.res, c.flags);
+    if (!(c.flags & IORING_CQE_F_MORE)) {
+      _ops.erase(c.op);
+      delete c.op;
+    }
+  }
+  // 复用vector的内存
+  completions.clear();
+  if (_completions.empty()) _completions.swap(completions);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "inline_function.h"
+#include "poller.h"
+
+struct msghdr;
+
+struct io_uring_params;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace muduo {
+
+// io_uring作为poller的实现，直接使用io_uring_setup/io_uring_enter系统调用，不依赖liburing
+//
+// 每个关注了事件的Channel对应一个oneshot的IORING_OP_POLL_ADD请求，事件返回之后在下一次poll时重新提交。
+// 没有使用multishot poll：它只在fd有新的唤醒时才产生CQE，相当于边沿触发，
+// 而Channel的使用者(以及EventLoop的channel预算)都假设水平触发，没有读完的数据必须在下一轮再次报告。
+// oneshot的POLL_ADD在提交时会先检查一次就绪状态，所以重新提交就得到了水平触发的语义。
+// 一轮中所有的重新提交、关注事件的修改和删除都先攒在SQ中，和等待事件合并成一次io_uring_enter，
+// 而epoll每次修改关注事件都需要一次epoll_ctl。
+//
+// 除了就绪通知，还提供完成模式的异步操作(TcpConnection的completion mode使用)：
+// recv_multishot把数据收进内核选择的provided buffer，不需要每次事件一次read(2)；
+// send直接提交SQE，内核在socket可写时完成发送，不需要先等POLLOUT。
+// 完成事件不在poll中回调，而是通过一个内部的Channel(fd为ring fd)交给EventLoop按正常的流程分发，
+// 所以同样受优先级、channel预算、统计和心跳的管理。
+class IoUringPoller : public Poller {
+public:
+  // @res: cqe->res，@flags: cqe->flags，flags中没有IORING_CQE_F_MORE表示这是该操作的最后一个完成事件
+  using CompletionCallback = InlineFunction<void(int res, uint32_t flags)>;
+
+  // 内核不支持io_uring、被禁用或者缺少需要的特性时返回nullptr，由调用者退回到epoll
+  static IoUringPoller *create(EventLoop *loop);
+  ~IoUringPoller() override;
+
+  Timestamp   poll(int64_t timeout_us, std::vector<Channel *> *active_channels) override;
+  void        update_channel(Channel *) override;
+  void        remove_channel(Channel *) override;
+  const char *name() const override { return "io_uring"; }
+  // IORING_ENTER_EXT_ARG的超时是__kernel_timespec
+  bool        supports_precise_timeout() const override { return true; }
+
+  // 以下只能在loop线程中调用
+  // 第一次调用时向内核提供一组provided buffer，内核不支持(6.0之前)时返回false
+  bool enable_completion_mode();
+  // 返回操作的id，用于cancel；操作的最后一个完成事件回调之后，id失效
+  uint64_t recv_multishot(int fd, CompletionCallback cb);
+  // buf在完成事件回调之前必须保持有效且不被修改
+  uint64_t send(int fd, const void *buf, size_t len, CompletionCallback cb);
+  // 一次发送msg中的多段数据，msg和其中的iovec、数据在完成事件回调之前都必须保持有效且不被修改
+  uint64_t sendmsg(int fd, const struct msghdr *msg, CompletionCallback cb);
+  // 异步取消，被取消的操作仍然会以-ECANCELED(或者已经完成的结果)回调一次
+  void cancel(uint64_t op_id);
+  // recv完成事件中的数据所在的buffer，用完之后必须recycle_buffer还给内核
+  const char *provided_buffer(uint16_t bid) const;
+  void        recycle_buffer(uint16_t bid);
+
+private:
+  struct Op {
+    CompletionCallback callback;
+  };
+  struct Completion {
+    Op      *op;
+    int      res;
+    uint32_t flags;
+  };
+
+  IoUringPoller(EventLoop *loop, int ring_fd);
+  bool setup_rings(const io_uring_params &params);
+
+  io_uring_sqe *get_sqe();
+  void          arm(Channel *ch);
+  void          disarm(Channel *ch);
+  void          rearm_fired_channels();
+  unsigned      sq_pending() const;
+  int           enter(unsigned to_submit, unsigned min_complete, int64_t timeout_us);
+  void          reap(std::vector<Channel *> *active_channels);
+  uint64_t      add_op(io_uring_sqe *sqe, CompletionCallback cb);
+  void          handle_completions();
+  void          provide_buffers(uint16_t first_bid, unsigned count);
+
+  int _ring_fd;
+
+  // SQ/CQ ring的mmap区域
+  void         *_ring_ptr;
+  size_t        _ring_size;
+  io_uring_sqe *_sqes;
+  size_t        _sqes_size;
+
+  unsigned     *_sq_head;
+  unsigned     *_sq_tail;
+  unsigned     *_sq_flags;
+  unsigned      _sq_mask;
+  unsigned      _sq_entries;
+  unsigned      _sq_local_tail; // 已经填好但还没有发布给内核的SQE的尾部
+  unsigned     *_cq_head;
+  unsigned     *_cq_tail;
+  unsigned      _cq_mask;
+  io_uring_cqe *_cqes;
+
+  // Channel的index记录它当前的POLL_ADD请求的序号，0表示没有在等待的请求，-1表示不在_channels中
+  // user_data = fd << 32 | 序号，fd被关闭后又被复用时，用序号区分过期的CQE
+  int32_t          _next_seq;
+  std::vector<int> _fired_fds; // 上一轮返回了事件的fd，下一次poll时重新提交
+
+  // 完成模式
+  std::unordered_set<Op *> _ops;         // 还没有收到最后一个完成事件的操作
+  std::vector<Completion>  _completions; // 已经收到、等待分发的完成事件
+  std::unique_ptr<Channel> _completion_channel;
+  bool                     _completion_mode_probed;
+  bool                     _completion_mode;
+  std::unique_ptr<char[]>  _buffers;
+};
+
+} // namespace muduo
@@ -0,0 +1,54 @@
+#include "loop_stats.h"
+
+#include <stdio.h>
+
+using namespace muduo;
+
+uint64_t Histogram::Snapshot::percentile(double p) const {
+  if (count == 0) return 0;
+  uint64_t target = static_cast<uint64_t>(p * static_cast<double>(count));
+  if (target >= count) target = count - 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets[ i ];
+    if (seen > target) {
+      if (i == 0) return 0;
+      uint64_t upper = i == 64 ? UINT64_MAX : (uint64_t(1) << i) - 1;
+      return upper < max ? upper : max;
+    }
+  }
+  return max;
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snap;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    snap.buckets[ i ] = _buckets[ i ].load(std::memory_order_relaxed);
+  }
+  snap.count = _count.load(std::memory_order_relaxed);
+  snap.sum = _sum.load(std::memory_order_relaxed);
+  snap.max = _max.load(std::memory_order_relaxed);
+  return snap;
+}
+
+namespace {
+void append_histogram(std::string *out, const char *name, const Histogram &histogram) {
+  auto snap = histogram.snapshot();
+  char buf[ 160 ];
+  snprintf(buf, sizeof buf, "%s{n=%lu mean=%.1f p50=%lu p99=%lu max=%lu} ", name, snap.count, snap.mean(),
+           snap.percentile(0.5), snap.percentile(0.99), snap.max);
+  out->append(buf);
+}
+} // namespace
+
+std::string EventLoopStats::to_string() const {
+  std::string out;
+  append_histogram(&out, "poll_ns", poll_ns);
+  append_histogram(&out, "active_channels", active_channels);
+  append_histogram(&out, "dispatch_ns", dispatch_ns);
+  append_histogram(&out, "functors_ns", functors_ns);
+  append_histogram(&out, "functors_count", functors_count);
+  append_histogram(&out, "timers_ns", timers_ns);
+  if (!out.empty()) out.pop_back();
+  return out;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+#include <string>
+#include <typeinfo>
+
+namespace muduo {
+
+// 单调时钟的纳秒数，用于统计耗时
+inline int64_t monotonic_ns() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 以2的幂为桶边界的无锁直方图
+// 只有一个写者(loop线程)，所以record用relaxed的load+store而不是原子加，几乎没有开销
+// 其他线程可以随时snapshot，各个桶之间不保证是同一时刻的值，但每个值本身是完整的
+class Histogram {
+public:
+  static const int kNumBuckets = 65; // 桶i存放[2^(i-1), 2^i)，桶0只存放0
+
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t buckets[ kNumBuckets ] = {0};
+
+    double mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+    // 返回第p(0~1)分位所在桶的上界
+    uint64_t percentile(double p) const;
+  };
+
+  Histogram() = default;
+  Histogram(const Histogram &) = delete;
+  Histogram &operator=(const Histogram &) = delete;
+
+  // 只能在单个写线程中调用
+  void record(uint64_t value) {
+    int idx = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    bump(_buckets[ idx ], 1);
+    bump(_count, 1);
+    bump(_sum, value);
+    if (value > _max.load(std::memory_order_relaxed)) {
+      _max.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  // 任意线程可调用
+  Snapshot snapshot() const;
+
+private:
+  static void bump(std::atomic<uint64_t> &v, uint64_t n) {
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> _buckets[ kNumBuckets ] = {};
+  std::atomic<uint64_t> _count{0};
+  std::atomic<uint64_t> _sum{0};
+  std::atomic<uint64_t> _max{0};
+};
+
+// 每个EventLoop一份的统计数据，每轮循环记录一次
+// 时间单位都是纳秒；dispatch_ns包含了在channel回调中执行的定时器回调
+struct EventLoopStats {
+  Histogram poll_ns;         // 阻塞在Poller::poll中的时间(包括busy poll的自旋)
+  Histogram active_channels; // 每轮poll返回的活动channel数
+  Histogram dispatch_ns;     // 每轮Channel::handle_event的总耗时
+  Histogram functors_ns;     // 每轮call_pending_functors的耗时
+  Histogram functors_count;  // 每轮执行的pending functor个数
+  Histogram timers_ns;       // 每次执行一批到期定时器回调的耗时(timerfd触发或者poll超时返回之后)
+
+  // 便于打日志的摘要，例如 poll_ns{n=.. mean=.. p50=.. p99=.. max=..} ...
+  std::string to_string() const;
+};
+
+// loop每轮发布的心跳，供LoopWatchdog在其他线程读取，用来发现和定位卡住的回调
+struct LoopHeartbeat {
+  std::atomic<int64_t>               busy_since_ns{0}; // 本轮开始处理事件的时间，0表示阻塞在poll中
+  std::atomic<int>                   fd{-1};           // 正在处理的Channel的fd
+  std::atomic<const std::type_info *> functor{nullptr}; // 正在执行的pending functor的类型
+  std::atomic<bool>                  timers{false};    // 正在执行到期的定时器回调
+};
+
+} // namespace muduo
@@ -0,0 +1,190 @@
+#include "loop_watchdog.h"
+
+#include <cxxabi.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <glog/logging.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#if __has_include(<libunwind.h>)
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+#define MUDUO_HAVE_LIBUNWIND 1
+#endif
+
+#include "event_loop.h"
+
+using namespace muduo;
+
+namespace {
+
+const int kStackSignal = SIGURG;
+const int kMaxFrames = 64;
+
+// 同一时刻只抓取一个线程的调用栈，由g_capture_mutex保护
+std::mutex       g_capture_mutex;
+void            *g_frames[ kMaxFrames ];
+std::atomic<int> g_num_frames{-1};
+
+// 在被卡住的loop线程中执行，只做异步信号安全的事情
+void capture_stack_handler(int) {
+  int saved_errno = errno;
+#ifdef MUDUO_HAVE_LIBUNWIND
+  int n = unw_backtrace(g_frames, kMaxFrames);
+#else
+  int n = ::backtrace(g_frames, kMaxFrames);
+#endif
+  g_num_frames.store(n, std::memory_order_release);
+  errno = saved_errno;
+}
+
+void install_stack_signal_handler() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    // backtrace第一次调用时会加载libgcc，不能发生在信号处理函数中，先预热一次
+    void *warmup[ 1 ];
+    ::backtrace(warmup, 1);
+    struct sigaction sa;
+    memset(&sa, 0x00, sizeof sa);
+    sa.sa_handler = capture_stack_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (::sigaction(kStackSignal, &sa, nullptr) != 0) {
+      LOG(ERROR) << "LoopWatchdog install signal handler failed.";
+    }
+  });
+}
+
+std::string demangle(const char *name) {
+  int   status = 0;
+  char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status != 0 || demangled == nullptr) {
+    return name;
+  }
+  std::string result(demangled);
+  free(demangled);
+  return result;
+}
+
+} // namespace
+
+LoopWatchdog::LoopWatchdog(double budget_seconds, bool capture_stack)
+    : _budget_ns(static_cast<int64_t>(budget_seconds * 1e9))
+    , _capture_stack(capture_stack)
+    , _exiting(false)
+    , _thread(&LoopWatchdog::thread_func, this) {
+  assert(_budget_ns > 0);
+  if (_capture_stack) {
+    install_stack_signal_handler();
+  }
+}
+
+LoopWatchdog::~LoopWatchdog() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _exiting = true;
+    _cond.notify_one();
+  }
+  _thread.join();
+  for (auto &watched : _watched) {
+    watched.loop->enable_heartbeat(false);
+  }
+}
+
+void LoopWatchdog::watch(EventLoop *loop) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  loop->enable_heartbeat(true);
+  _watched.push_back({loop, 0});
+}
+
+void LoopWatchdog::unwatch(EventLoop *loop) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = std::find_if(_watched.begin(), _watched.end(), [ loop ](const Watched &w) { return w.loop == loop; });
+  if (it != _watched.end()) {
+    loop->enable_heartbeat(false);
+    _watched.erase(it);
+  }
+}
+
+void LoopWatchdog::set_stall_callback(StallCallback cb) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _stall_callback = std::move(cb);
+}
+
+// 持有_mutex检查，保证检查期间被watch的loop不会被unwatch之后析构
+void LoopWatchdog::thread_func() {
+  const auto interval = std::chrono::nanoseconds(std::max<int64_t>(_budget_ns / 2, 1000000));
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (!_exiting) {
+    _cond.wait_for(lock, interval, [ this ] { return _exiting; });
+    if (_exiting) break;
+    int64_t now_ns = monotonic_ns();
+    for (auto &watched : _watched) {
+      check(&watched, now_ns);
+    }
+  }
+}
+
+void LoopWatchdog::check(Watched *watched, int64_t now_ns) {
+  int64_t busy_since_ns = watched->loop->heartbeat().busy_since_ns.load(std::memory_order_relaxed);
+  if (busy_since_ns == 0 || busy_since_ns == watched->reported_busy_since_ns) {
+    return;
+  }
+  if (now_ns - busy_since_ns > _budget_ns) {
+    watched->reported_busy_since_ns = busy_since_ns;
+    report(watched->loop, now_ns - busy_since_ns);
+  }
+}
+
+void LoopWatchdog::report(EventLoop *loop, int64_t stalled_ns) {
+  const auto &heartbeat = loop->heartbeat();
+  Stall       stall;
+  stall.loop = loop;
+  stall.stalled_ns = stalled_ns;
+  stall.iteration = loop->iteration();
+  stall.fd = heartbeat.fd.load(std::memory_order_relaxed);
+  stall.functor = heartbeat.functor.load(std::memory_order_relaxed);
+  stall.timers = heartbeat.timers.load(std::memory_order_relaxed);
+
+  std::string running;
+  // timerfd模式下定时器回调在timerfd的Channel中执行，fd也被设置，先看timers
+  if (stall.timers) {
+    running = "expired timers";
+  } else if (stall.fd >= 0) {
+    running = "channel fd=" + std::to_string(stall.fd);
+  } else if (stall.functor) {
+    running = "pending functor " + demangle(stall.functor->name());
+  } else {
+    running = "event_loop internals";
+  }
+  LOG(WARNING) << "LoopWatchdog: event_loop[" << loop << "] stalled for " << stalled_ns / 1000 << "us in iteration "
+               << stall.iteration << ", running " << running;
+  if (_stall_callback) _stall_callback(stall);
+
+  if (!_capture_stack) return;
+  std::lock_guard<std::mutex> lock(g_capture_mutex);
+  g_num_frames.store(-1, std::memory_order_relaxed);
+  if (::pthread_kill(loop->pthread_handle(), kStackSignal) != 0) {
+    LOG(WARNING) << "LoopWatchdog: pthread_kill event_loop[" << loop << "] failed.";
+    return;
+  }
+  int num_frames = -1;
+  for (int i = 0; i < 100 && num_frames < 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    num_frames = g_num_frames.load(std::memory_order_acquire);
+  }
+  if (num_frames <= 0) {
+    LOG(WARNING) << "LoopWatchdog: capture stack of event_loop[" << loop << "] timed out.";
+    return;
+  }
+  char **symbols = ::backtrace_symbols(g_frames, num_frames);
+  for (int i = 0; i < num_frames; ++i) {
+    LOG(WARNING) << "LoopWatchdog:   #" << i << " " << (symbols ? symbols[ i ] : "?") << " [" << g_frames[ i ] << "]";
+  }
+  free(symbols);
+}
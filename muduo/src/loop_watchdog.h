@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <boost/noncopyable.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+namespace muduo {
+
+class EventLoop;
+
+// 检测卡住的EventLoop
+//
+// 一个慢回调会卡住同一个I/O线程上的所有连接。被watch的loop每轮发布心跳(见LoopHeartbeat)，
+// watchdog线程每隔budget/2检查一次，如果某一轮处理事件的时间超过budget，就打印WARNING日志，
+// 指出正在处理哪个Channel的fd、哪个pending functor或者到期的定时器回调，以及已经卡了多久，每次卡顿只报告一次。
+// 打开capture_stack后还会向loop线程发送SIGURG，在信号处理函数中用libunwind抓取调用栈并打印。
+class LoopWatchdog : public boost::noncopyable {
+public:
+  // 一次卡顿的信息，报告时从loop的心跳中读取
+  struct Stall {
+    EventLoop            *loop;
+    int64_t               stalled_ns;
+    int64_t               iteration; // 卡在loop的第几轮(EventLoop::iteration())
+    int                   fd;        // 正在处理的Channel的fd，-1表示没有
+    const std::type_info *functor;   // 正在执行的pending functor的类型，nullptr表示没有
+    bool                  timers;    // 正在执行到期的定时器回调
+  };
+  using StallCallback = std::function<void(const Stall &)>;
+
+  explicit LoopWatchdog(double budget_seconds, bool capture_stack = false);
+  ~LoopWatchdog();
+
+  // 线程安全，loop析构之前必须unwatch
+  void watch(EventLoop *loop);
+  void unwatch(EventLoop *loop);
+  // 每次报告卡顿时在watchdog线程中调用(打印日志之后、抓取调用栈之前)，
+  // 调用时持有内部的锁，回调中不能watch/unwatch
+  void set_stall_callback(StallCallback cb);
+
+private:
+  struct Watched {
+    EventLoop *loop;
+    int64_t    reported_busy_since_ns; // 已经报告过的那次卡顿，避免重复报告
+  };
+
+  void thread_func();
+  void check(Watched *watched, int64_t now_ns);
+  void report(EventLoop *loop, int64_t stalled_ns);
+
+  const int64_t           _budget_ns;
+  const bool              _capture_stack;
+  std::mutex              _mutex;
+  std::condition_variable _cond;
+  bool                    _exiting; // guarded by _mutex
+  std::vector<Watched>    _watched; // guarded by _mutex
+  StallCallback           _stall_callback; // guarded by _mutex
+  std::thread             _thread;
+};
+
+} // namespace muduo
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace muduo {
+
+// 多生产者单消费者(MPSC)的无锁队列
+//
+// 生产者用CAS把节点压入一个链栈，消费者用一次exchange摘走整条链再反转成FIFO。
+// 节点由队列分配(非侵入式)，元素本身不需要带next指针。
+//
+// 节点不逐个new/delete：用完的节点放回当前线程的缓存，攒够kCachedNodes个之后整串压入全局的空闲链栈，
+// 线程自己的缓存用完时用一次exchange把全局空闲链栈整个拿走。拿走和压入都不遍历链表。
+// 压入是整串CAS、取走是exchange，都不依赖读到的next指针，没有ABA问题。
+// 这样跨线程提交时稳定状态下没有堆分配，节点总数由同时在队列中的元素的峰值决定。
+// 所以消费者每次拿到的是"某一时刻之前所有已提交元素"的快照，顺序即CAS成功的先后顺序。
+// 这和原来 mutex + vector::swap 的语义一致：消费过程中新提交的元素留到下一批处理。
+// 整链摘取不存在逐个pop的ABA问题。
+template <typename T>
+class MpscQueue {
+  // value只在节点被使用时构造，空闲的节点中没有元素
+  struct Node {
+    Node() {}
+    ~Node() {}
+    Node *next = nullptr;
+    union {
+      T value;
+    };
+  };
+
+  // 空闲节点的缓存，同一类型的所有队列共用
+  class NodePool {
+  public:
+    static Node *acquire(T &&value) {
+      Cache &cache = local_cache();
+      Node  *node;
+      if (cache.released) {
+        node = cache.released;
+        cache.released = node->next;
+        if (--cache.released_size == 0) cache.released_tail = nullptr;
+      } else {
+        if (cache.grabbed == nullptr) cache.grabbed = global_free().exchange(nullptr, std::memory_order_acquire);
+        if (cache.grabbed) {
+          node = cache.grabbed;
+          cache.grabbed = node->next;
+        } else {
+          node = new Node;
+        }
+      }
+      new (&node->value) T(std::move(value));
+      node->next = nullptr;
+      return node;
+    }
+
+    static void release(Node *node) {
+      node->value.~T();
+      Cache &cache = local_cache();
+      node->next = cache.released;
+      if (cache.released == nullptr) cache.released_tail = node;
+      cache.released = node;
+      if (++cache.released_size == kCachedNodes) {
+        push_chain(cache.released, cache.released_tail);
+        cache.released = cache.released_tail = nullptr;
+        cache.released_size = 0;
+      }
+    }
+
+  private:
+    static const size_t kCachedNodes = 256;
+
+    // released是本线程用完的节点，数量有限，先复用它们；grabbed是从全局拿来的整串，数量未知
+    struct Cache {
+      Node  *released = nullptr;
+      Node  *released_tail = nullptr;
+      size_t released_size = 0;
+      Node  *grabbed = nullptr;
+
+      // 线程退出时把缓存的节点交给其他线程
+      ~Cache() {
+        if (released) push_chain(released, released_tail);
+        if (grabbed) {
+          Node *tail = grabbed;
+          while (tail->next) tail = tail->next;
+          push_chain(grabbed, tail);
+        }
+      }
+    };
+
+    static void push_chain(Node *head, Node *tail) {
+      std::atomic<Node *> &stack = global_free();
+      Node                *top = stack.load(std::memory_order_relaxed);
+      do {
+        tail->next = top;
+      } while (!stack.compare_exchange_weak(top, head, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static Cache &local_cache() {
+      thread_local Cache cache;
+      return cache;
+    }
+    // 平凡析构，进程退出时其他线程的Cache析构仍然可以使用；剩下的节点随进程释放
+    static std::atomic<Node *> &global_free() {
+      static std::atomic<Node *> stack{nullptr};
+      return stack;
+    }
+  };
+
+public:
+  // 消费者持有的一批元素，按提交顺序排列，只能在单线程中使用
+  class Batch {
+    friend class MpscQueue;
+
+  public:
+    Batch() = default;
+    Batch(Batch &&other) noexcept
+        : _head(std::exchange(other._head, nullptr))
+        , _tail(std::exchange(other._tail, nullptr))
+        , _size(std::exchange(other._size, 0)) {}
+    Batch &operator=(Batch &&other) noexcept {
+      if (this != &other) {
+        clear();
+        _head = std::exchange(other._head, nullptr);
+        _tail = std::exchange(other._tail, nullptr);
+        _size = std::exchange(other._size, 0);
+      }
+      return *this;
+    }
+    Batch(const Batch &) = delete;
+    Batch &operator=(const Batch &) = delete;
+    ~Batch() { clear(); }
+
+    bool   empty() const { return _head == nullptr; }
+    size_t size() const { return _size; }
+    T     &front() { return _head->value; }
+
+    void pop_front() {
+      Node *node = _head;
+      _head = node->next;
+      if (_head == nullptr) _tail = nullptr;
+      --_size;
+      NodePool::release(node);
+    }
+
+    void push_back(T value) { link_back(NodePool::acquire(std::move(value))); }
+
+    // 把other整体接到尾部，other中的元素都比本批次的新
+    void append(Batch &&other) {
+      if (other.empty()) return;
+      if (empty()) {
+        *this = std::move(other);
+        return;
+      }
+      _tail->next = std::exchange(other._head, nullptr);
+      _tail = std::exchange(other._tail, nullptr);
+      _size += std::exchange(other._size, 0);
+    }
+
+    void clear() {
+      while (_head) pop_front();
+    }
+
+  private:
+    void link_back(Node *node) {
+      if (_tail) {
+        _tail->next = node;
+      } else {
+        _head = node;
+      }
+      _tail = node;
+      ++_size;
+    }
+
+    Node  *_head = nullptr;
+    Node  *_tail = nullptr;
+    size_t _size = 0;
+  };
+
+public:
+  MpscQueue()
+      : _top(nullptr) {}
+  ~MpscQueue() { take_all(); }
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  // 任意线程可调用
+  // @return: 压入之前队列是否为空
+  bool push(T value) {
+    Node *node = NodePool::acquire(std::move(value));
+    return push_chain(node, node);
+  }
+
+  // 任意线程可调用，整批只做一次CAS，批内顺序保持不变，不会和其他生产者的元素交错
+  // @return: 压入之前队列是否为空，batch为空时返回false
+  bool push_batch(Batch batch) {
+    if (batch.empty()) return false;
+    // 栈中是从新到旧链接的，所以先把批次反转过来
+    Node *oldest = batch._head;
+    Node *newest = reverse(std::exchange(batch._head, nullptr), nullptr);
+    batch._tail = nullptr;
+    batch._size = 0;
+    return push_chain(newest, oldest);
+  }
+
+  // 任意线程可调用，结果只是一个瞬时值
+  bool empty() const { return _top.load() == nullptr; }
+
+  // 只能在消费者线程调用
+  Batch take_all() {
+    Batch batch;
+    Node *top = _top.exchange(nullptr);
+    if (top == nullptr) return batch;
+    batch._tail = top;
+    batch._head = reverse(top, &batch._size);
+    return batch;
+  }
+
+private:
+  bool push_chain(Node *newest, Node *oldest) {
+    Node *top = _top.load(std::memory_order_relaxed);
+    do {
+      oldest->next = top;
+    } while (!_top.compare_exchange_weak(top, newest));
+    return top == nullptr;
+  }
+
+  static Node *reverse(Node *node, size_t *count) {
+    Node  *prev = nullptr;
+    size_t n = 0;
+    while (node) {
+      ++n;
+      Node *next = node->next;
+      node->next = prev;
+      prev = node;
+      node = next;
+    }
+    if (count) *count = n;
+    return prev;
+  }
+
+  std::atomic<Node *> _top;
+};
+
+} // namespace muduo
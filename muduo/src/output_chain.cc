@@ -0,0 +1,108 @@
+#include "output_chain.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+
+using namespace muduo;
+
+const size_t OutputChain::kChunkSize;
+const size_t OutputChain::kMinSliceSize;
+const int    OutputChain::kMaxIov;
+
+OutputChain::OutputChain(ChunkPool *pool)
+    : _pool(pool)
+    , _bytes(0) {}
+
+OutputChain::~OutputChain() { retrieve_all(); }
+
+char *OutputChain::alloc_chunk() { return _pool ? _pool->allocate() : new char[ kChunkSize ]; }
+
+void OutputChain::release(Segment *segment) {
+  if (segment->chunk) {
+    if (_pool) {
+      _pool->deallocate(segment->chunk);
+    } else {
+      delete[] segment->chunk;
+    }
+  }
+  segment->owner.reset();
+}
+
+void OutputChain::append(const void *data, size_t len) {
+  const char *src = static_cast<const char *>(data);
+  _bytes += len;
+  while (len > 0) {
+    // 尾部chunk中还没用的空间
+    if (!_segments.empty() && _segments.back().chunk) {
+      Segment &tail = _segments.back();
+      char    *end = const_cast<char *>(tail.data) + tail.size;
+      size_t   n = std::min(len, static_cast<size_t>(tail.chunk + kChunkSize - end));
+      if (n > 0) {
+        ::memcpy(end, src, n);
+        tail.size += n;
+        src += n;
+        len -= n;
+        continue;
+      }
+    }
+    char *chunk = alloc_chunk();
+    _segments.push_back(Segment{chunk, chunk, 0, nullptr});
+  }
+}
+
+void OutputChain::append_slice(std::string_view data, std::shared_ptr<const void> owner) {
+  if (data.size() < kMinSliceSize) {
+    append(data.data(), data.size());
+    return;
+  }
+  _bytes += data.size();
+  _segments.push_back(Segment{nullptr, data.data(), data.size(), std::move(owner)});
+}
+
+void OutputChain::retrieve(size_t len) {
+  assert(len <= _bytes);
+  _bytes -= len;
+  while (len > 0) {
+    Segment &front = _segments.front();
+    if (len < front.size) {
+      front.data += len;
+      front.size -= len;
+      return;
+    }
+    len -= front.size;
+    release(&front);
+    _segments.pop_front();
+  }
+}
+
+void OutputChain::retrieve_all() {
+  for (Segment &segment : _segments) release(&segment);
+  _segments.clear();
+  _bytes = 0;
+}
+
+int OutputChain::fill_iovec(struct iovec *iov, int max) const {
+  int count = 0;
+  for (const Segment &segment : _segments) {
+    if (count == max) break;
+    iov[ count ].iov_base = const_cast<char *>(segment.data);
+    iov[ count ].iov_len = segment.size;
+    ++count;
+  }
+  return count;
+}
+
+ssize_t OutputChain::write_fd(int fd, int *saved_errno) {
+  struct iovec iov[ kMaxIov ];
+  int          count = fill_iovec(iov, kMaxIov);
+  ssize_t      n = ::writev(fd, iov, count);
+  if (n < 0) {
+    *saved_errno = errno;
+  } else {
+    retrieve(static_cast<size_t>(n));
+  }
+  return n;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <deque>
+#include <memory>
+#include <string_view>
+
+#include "chunk_pool.h"
+
+namespace muduo {
+
+// TcpConnection的输出缓冲区，由一串segment组成，每个segment是一块固定大小的chunk或者借用的外部数据(slice)
+//
+// 和单个连续的Buffer相比，积压了很多数据时追加新数据不需要realloc、也不需要把还没发送的数据整体挪动，
+// 发送时用writev一次最多提交kMaxIov个segment，chunk从ChunkPool借，发送完立即归还，没有待发送的数据时不占内存。
+// slice不拷贝数据，由owner保证数据在发送完之前有效，发送完(或者丢弃)时释放owner。
+// 只有已经写在某个segment中的数据不会再被修改，所以整段交给内核异步发送(io_uring)期间仍然可以继续追加。
+//
+// 不是线程安全的，只在所属连接的loop线程中使用
+class OutputChain {
+public:
+  static const size_t kChunkSize = ChunkPool::kChunkSize;
+  // 小于这个长度的slice直接拷贝到chunk中，避免writev时出现很多很小的iovec
+  static const size_t kMinSliceSize = 1024;
+  // write_fd一次最多提交的segment数，iovec数组放在栈上；剩下的等下一次可写事件再发送
+  static const int kMaxIov = 64;
+
+  // pool为nullptr时chunk直接new/delete
+  explicit OutputChain(ChunkPool *pool = nullptr);
+  ~OutputChain();
+
+  OutputChain(const OutputChain &) = delete;
+  OutputChain &operator=(const OutputChain &) = delete;
+
+  size_t readable_bytes() const { return _bytes; }
+  bool   empty() const { return _bytes == 0; }
+  size_t segments() const { return _segments.size(); }
+
+  // 拷贝到尾部的chunk中，放不下时追加新的chunk
+  void append(std::string_view data) { append(data.data(), data.size()); }
+  void append(const void *data, size_t len);
+  // 不拷贝，data在owner释放之前必须有效
+  void append_slice(std::string_view data, std::shared_ptr<const void> owner);
+
+  // 取走最前面len字节已经发送的数据，发送完的chunk还给pool
+  void retrieve(size_t len);
+  void retrieve_all();
+
+  // 从头开始的最多max个segment，返回个数
+  int fill_iovec(struct iovec *iov, int max) const;
+  // 用writev发送，返回writev的返回值，出错时设置saved_errno
+  ssize_t write_fd(int fd, int *saved_errno);
+
+private:
+  struct Segment {
+    char                       *chunk; // 自己的chunk，slice为nullptr
+    const char                 *data;  // 还没有发送的数据的起点
+    size_t                      size;  // 还没有发送的字节数
+    std::shared_ptr<const void> owner; // slice的所有者
+  };
+
+  char *alloc_chunk();
+  void  release(Segment *segment);
+
+  ChunkPool          *_pool;
+  std::deque<Segment> _segments;
+  size_t              _bytes;
+};
+
+} // namespace muduo
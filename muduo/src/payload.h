@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace muduo {
+
+// 不可变的、引用计数的一段数据，用于把同一条消息发给很多连接(比如pub/sub的扇出)
+//
+// 拷贝Payload只增加引用计数，不拷贝数据。TcpConnection::send(const Payload &)把数据作为slice挂到输出缓冲区，
+// 每个连接持有一份引用，最后一个连接发送完(writev返回或者io_uring的send完成)或者断开之后数据才释放。
+// 小于OutputChain::kMinSliceSize的数据仍然会拷贝到各个连接的输出缓冲区，这时拷贝比多一个iovec便宜。
+//
+// 构造之后内容不再改变，可以在任意线程中拷贝和读取
+class Payload {
+public:
+  Payload() = default;
+  explicit Payload(std::string data)
+      : _data(std::make_shared<const std::string>(std::move(data))) {}
+  Payload(const void *data, size_t len)
+      : Payload(std::string(static_cast<const char *>(data), len)) {}
+
+  const char      *data() const { return _data ? _data->data() : nullptr; }
+  size_t           size() const { return _data ? _data->size() : 0; }
+  bool             empty() const { return size() == 0; }
+  std::string_view view() const { return _data ? std::string_view(*_data) : std::string_view(); }
+  // 发送时交给输出缓冲区的owner，也可以用来观察数据什么时候被释放
+  const std::shared_ptr<const std::string> &owner() const { return _data; }
+
+private:
+  std::shared_ptr<const std::string> _data;
+};
+
+} // namespace muduo
@@ -1,7 +1,13 @@
 #include "poller.h"
 
+#include <glog/logging.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "channel.h"
+#include "epoll_poller.h"
 #include "event_loop.h"
+#include "io_uring_poller.h"
 
 using namespace muduo;
 
@@ -13,8 +19,23 @@ Poller::~Poller() = default;
 // 只能在loop线程中运行
 bool Poller::has_channel(Channel *ch) const {
   assert_in_loop_thread();
-  auto it = _channels.find(ch->fd());
-  return it != _channels.end() && it->second == ch;
+  return _channels.find(ch->fd()) == ch;
 }
 
-void Poller::assert_in_loop_thread() const { return _owner_loop->assert_in_loop_thread(); }
\ No newline at end of file
+void Poller::assert_in_loop_thread() const { return _owner_loop->assert_in_loop_thread(); }
+
+Poller *Poller::new_default_poller(EventLoop *loop) { return new_poller(loop, PollerBackend::kDefault); }
+
+Poller *Poller::new_poller(EventLoop *loop, PollerBackend backend) {
+  if (backend == PollerBackend::kDefault) {
+    const char *env = ::getenv("MUDUO_POLLER");
+    backend = (env && strcmp(env, "io_uring") == 0) ? PollerBackend::kIoUring : PollerBackend::kEpoll;
+  }
+  if (backend == PollerBackend::kIoUring) {
+    if (Poller *poller = IoUringPoller::create(loop)) {
+      return poller;
+    }
+    LOG(WARNING) << "io_uring is unavailable, fall back to epoll, loop=" << loop;
+  }
+  return new EPollPoller(loop);
+}
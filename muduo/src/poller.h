@@ -1,34 +1,51 @@
 #pragma once
 
-#include <map>
 #include <vector>
 
+#include "channel_map.h"
 #include "timestamp.h"
 
 namespace muduo {
 
 class Channel;
 class EventLoop;
+enum class PollerBackend;
 
 class Poller {
 public:
   Poller(EventLoop *loop);
   virtual ~Poller();
-  virtual Timestamp poll(int timeout_ms, std::vector<Channel *> *active_channels) = 0;
+  // timeout_us < 0 表示一直等待，0表示立即返回
+  virtual Timestamp poll(int64_t timeout_us, std::vector<Channel *> *active_channels) = 0;
 
   // think about their thread-safety ?
   virtual bool has_channel(Channel *) const;
   virtual void update_channel(Channel *) = 0;
   virtual void remove_channel(Channel *) = 0;
-
+  virtual const char *name() const = 0;
+  // 是否支持Channel的边沿触发模式
+  virtual bool supports_edge_triggered() const { return false; }
+  // poll的超时是否精确到微秒，是的话定时器可以直接用poll的超时触发，不需要timerfd
+  virtual bool supports_precise_timeout() const { return false; }
+
+  // poller自己发起的系统调用次数(epoll_wait/epoll_ctl/io_uring_enter)，只能在loop线程中读取
+  int64_t syscalls() const { return _syscalls; }
+  // 合并或者抵消掉、没有真正提交给内核的关注事件修改次数，只能在loop线程中读取
+  int64_t elided_updates() const { return _elided_updates; }
+
+  // 按环境变量MUDUO_POLLER(epoll或io_uring)选择，默认epoll
   static Poller *new_default_poller(EventLoop *loop);
+  // io_uring不可用时退回到epoll
+  static Poller *new_poller(EventLoop *loop, PollerBackend backend);
 
 protected:
   void assert_in_loop_thread() const;
   // fd to Channel pointer
   // TODO: think how to make sure its thread-safety ?
   // Answer: you can modify _channels only in loop thread, but by what means ?
-  std::map<int, Channel *> _channels;
+  ChannelMap _channels;
+  int64_t    _syscalls = 0;
+  int64_t    _elided_updates = 0;
 
 private:
   EventLoop *_owner_loop;
@@ -60,7 +60,10 @@ int sockets::accept(int sockfd, struct sockaddr_in6 *addr) {
   int       connfd = ::accept4(sockfd, sockaddr_cast(addr), &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
   if (connfd < 0) {
     int saved_errno = errno;
-    LOG(ERROR) << "Socket::accept error " << saved_errno;
+    // 边沿触发的Acceptor每次都以EAGAIN结束，不算错误
+    if (saved_errno != EAGAIN) {
+      LOG(ERROR) << "Socket::accept error " << saved_errno;
+    }
     switch (saved_errno) {
       case EAGAIN:
       case ECONNABORTED:
@@ -0,0 +1,570 @@
+#include "tcp_connection.h"
+
+#include <errno.h>
+#include <glog/logging.h>
+#include <linux/io_uring.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "channel.h"
+#include "chunk_pool.h"
+#include "event_loop.h"
+#include "idle_timeout_manager.h"
+#include "io_uring_poller.h"
+#include "socket.h"
+#include "sockops.h"
+
+using namespace muduo;
+
+// 完成模式下进行中的sendmsg用到的msghdr和iovec，在完成事件回调之前必须保持有效
+struct TcpConnection::SendRequest {
+  static const int kMaxIov = OutputChain::kMaxIov;
+  struct msghdr    msg;
+  struct iovec     iov[ kMaxIov ];
+};
+
+void muduo::default_connection_callback(const std::shared_ptr<TcpConnection> &conn) {
+  LOG(INFO) << conn->local_address().to_ip_port() << " -> " << conn->peer_address().to_ip_port() << " is "
+            << (conn->connected() ? "UP" : "DOWN");
+}
+
+void muduo::default_message_callback(const std::shared_ptr<TcpConnection> &, Buffer *buf, Timestamp) {
+  buf->retrieve_all();
+}
+
+TcpConnection::TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &local_addr,
+                             const InetAddress &peer_addr)
+    : _loop(loop)
+    , _name(name)
+    , _state(kConnecting)
+    , _reading(true)
+    , _memory_paused(false)
+    , _socket(new Socket(sockfd))
+    , _channel(new Channel(loop, sockfd))
+    , _local_addr(local_addr)
+    , _peer_addr(peer_addr)
+    , _chunk_pool(loop->chunk_pool())
+    , _high_water_mark(64 * 1024 * 1024)
+    , _input_buffer(0)
+    , _output_buffer(_chunk_pool.get())
+    , _edge_triggered_requested(false)
+    , _completion_mode_requested(false)
+    , _uring(nullptr)
+    , _recv_op(0)
+    , _send_op(0) {
+  _channel->set_read_callback(std::bind(&TcpConnection::handle_read, this, std::placeholders::_1));
+  _channel->set_write_callback(std::bind(&TcpConnection::handle_write, this));
+  _channel->set_close_callback(std::bind(&TcpConnection::handle_close, this));
+  _channel->set_error_callback(std::bind(&TcpConnection::handle_error, this));
+  DLOG(INFO) << "TcpConnection::ctor[" << _name << "] at " << this << " fd=" << sockfd;
+  _socket->set_keep_alive(true);
+}
+
+TcpConnection::~TcpConnection() {
+  DLOG(INFO) << "TcpConnection::dtor[" << _name << "] at " << this << " fd=" << _channel->fd()
+             << " state=" << state_to_string();
+  assert(_state == kDisconnected);
+}
+
+bool TcpConnection::get_tcp_info(struct tcp_info *tcpi) const { return _socket->get_tcp_info(tcpi); }
+
+std::string TcpConnection::get_tcp_info_string() const {
+  char buf[ 1024 ];
+  buf[ 0 ] = '\0';
+  _socket->get_tcp_info_string(buf, sizeof buf);
+  return buf;
+}
+
+void TcpConnection::send(const void *data, size_t len) {
+  send(std::string_view(static_cast<const char *>(data), len));
+}
+
+void TcpConnection::send(std::string_view message) {
+  if (_state != kConnected) return;
+  if (_loop->is_in_loop_thread()) {
+    send_in_loop(message);
+  } else {
+    _loop->run_in_loop([ self = shared_from_this(), msg = std::string(message) ] { self->send_in_loop(msg); });
+  }
+}
+
+void TcpConnection::send(Buffer *buf) {
+  if (_state != kConnected) return;
+  if (_loop->is_in_loop_thread()) {
+    send_in_loop(buf->peek(), buf->readable_bytes());
+    buf->retrieve_all();
+  } else {
+    _loop->run_in_loop(
+      [ self = shared_from_this(), msg = buf->retrieve_all_as_string() ] { self->send_in_loop(msg); });
+  }
+}
+
+void TcpConnection::send_slice(std::string_view data, std::shared_ptr<const void> owner) {
+  if (_state != kConnected) return;
+  if (_loop->is_in_loop_thread()) {
+    send_in_loop(data.data(), data.size(), std::move(owner));
+  } else {
+    _loop->run_in_loop([ self = shared_from_this(), data, owner = std::move(owner) ]() mutable {
+      self->send_in_loop(data.data(), data.size(), std::move(owner));
+    });
+  }
+}
+
+void TcpConnection::send_in_loop(std::string_view message) { send_in_loop(message.data(), message.size()); }
+
+// 就绪模式：输出缓冲区为空时先尝试直接write，写不完的放入输出缓冲区并关注可写事件
+// 完成模式：放入输出缓冲区，没有进行中的send时立即提交
+void TcpConnection::send_in_loop(const void *data, size_t len, std::shared_ptr<const void> owner) {
+  _loop->assert_in_loop_thread();
+  if (_state == kDisconnected) {
+    LOG(WARNING) << "disconnected, give up writing";
+    return;
+  }
+  size_t nwrote = 0;
+  size_t remaining = len;
+  bool   fault_error = false;
+  if (!_uring && !waiting_writable() && _output_buffer.empty()) {
+    ssize_t n = sockets::write(_channel->fd(), data, len);
+    if (n >= 0) {
+      nwrote = static_cast<size_t>(n);
+      remaining = len - nwrote;
+      if (remaining == 0 && _write_complete_callback) {
+        _loop->queue_in_loop(std::bind(_write_complete_callback, shared_from_this()));
+      }
+    } else {
+      if (errno != EWOULDBLOCK) {
+        LOG(ERROR) << "TcpConnection::send_in_loop";
+        if (errno == EPIPE || errno == ECONNRESET) {
+          fault_error = true;
+        }
+      }
+    }
+  }
+
+  assert(remaining <= len);
+  if (!fault_error && remaining > 0) {
+    size_t old_len = pending_output_bytes();
+    if (old_len + remaining >= _high_water_mark && old_len < _high_water_mark && _high_water_mark_callback) {
+      _loop->queue_in_loop(std::bind(_high_water_mark_callback, shared_from_this(), old_len + remaining));
+    }
+    const char *rest = static_cast<const char *>(data) + nwrote;
+    if (owner) {
+      _output_buffer.append_slice(std::string_view(rest, remaining), std::move(owner));
+    } else {
+      _output_buffer.append(rest, remaining);
+    }
+    if (_uring) {
+      if (_send_op == 0) start_send();
+    } else if (!_channel->edge_triggered() && !_channel->is_writing()) {
+      // 边沿触发时可写事件一直关注着，write返回EAGAIN之后socket再次可写时会通知
+      _channel->enable_writing();
+    }
+  }
+}
+
+void TcpConnection::shutdown() {
+  if (_state == kConnected) {
+    set_state(kDisconnecting);
+    _loop->run_in_loop(std::bind(&TcpConnection::shutdown_in_loop, shared_from_this()));
+  }
+}
+
+// 还有数据没发完时不关闭，等handle_write或者send完成时再调用
+void TcpConnection::shutdown_in_loop() {
+  _loop->assert_in_loop_thread();
+  if (!waiting_writable() && _send_op == 0) {
+    _socket->shutdown_write();
+  }
+}
+
+void TcpConnection::force_close() {
+  if (_state == kConnected || _state == kDisconnecting) {
+    set_state(kDisconnecting);
+    _loop->queue_in_loop(std::bind(&TcpConnection::force_close_in_loop, shared_from_this()));
+  }
+}
+
+void TcpConnection::force_close_in_loop() {
+  _loop->assert_in_loop_thread();
+  if (_state == kConnected || _state == kDisconnecting) {
+    handle_close();
+  }
+}
+
+const char *TcpConnection::state_to_string() const {
+  switch (_state) {
+    case kDisconnected:
+      return "kDisconnected";
+    case kConnecting:
+      return "kConnecting";
+    case kConnected:
+      return "kConnected";
+    case kDisconnecting:
+      return "kDisconnecting";
+    default:
+      return "unknown state";
+  }
+}
+
+void TcpConnection::set_tcp_no_delay(bool on) { _socket->set_tcp_nodelay(on); }
+
+bool TcpConnection::edge_triggered() const { return _channel->edge_triggered(); }
+
+void TcpConnection::set_priority(Channel::Priority priority) {
+  _loop->run_in_loop([ this, priority ] { _channel->set_priority(priority); });
+}
+
+Channel::Priority TcpConnection::priority() const { return _channel->priority(); }
+
+bool TcpConnection::waiting_writable() const {
+  return _channel->edge_triggered() ? !_output_buffer.empty() : _channel->is_writing();
+}
+
+void TcpConnection::start_read() { _loop->run_in_loop(std::bind(&TcpConnection::start_read_in_loop, this)); }
+
+void TcpConnection::start_read_in_loop() {
+  _loop->assert_in_loop_thread();
+  if (_reading) return;
+  _reading = true;
+  apply_reading();
+}
+
+void TcpConnection::stop_read() { _loop->run_in_loop(std::bind(&TcpConnection::stop_read_in_loop, this)); }
+
+void TcpConnection::stop_read_in_loop() {
+  _loop->assert_in_loop_thread();
+  if (!_reading) return;
+  _reading = false;
+  apply_reading();
+}
+
+// 应用要求读(_reading)并且没有因为内存超限暂停时才读
+void TcpConnection::apply_reading() {
+  const bool want = _reading && !_memory_paused;
+  if (_uring) {
+    if (want && _recv_op == 0) {
+      start_recv();
+    } else if (!want && _recv_op != 0) {
+      _uring->cancel(_recv_op);
+    }
+  } else if (want && !_channel->is_reading()) {
+    _channel->enable_reading();
+  } else if (!want && _channel->is_reading()) {
+    _channel->disable_reading();
+  }
+}
+
+// 所有连接的缓冲区总量超过ChunkPool的全局上限时暂停读，不再为新的输入分配内存，返回是否暂停了。
+// 之后每隔kMemoryRetrySeconds检查一次，总量降到上限以下时恢复；大量连接同时暂停时用slack合并这些定时器
+bool TcpConnection::pause_if_over_memory_limit() {
+  if (_memory_paused) return true;
+  if (!ChunkPool::over_memory_limit()) return false;
+  const double kMemoryRetrySeconds = 0.01;
+  _memory_paused = true;
+  apply_reading();
+  std::weak_ptr<TcpConnection> weak_this = shared_from_this();
+  _loop->run_after(kMemoryRetrySeconds, kMemoryRetrySeconds, [ weak_this ] {
+    if (auto self = weak_this.lock()) self->resume_after_memory_limit();
+  });
+  return true;
+}
+
+void TcpConnection::resume_after_memory_limit() {
+  _memory_paused = false;
+  if (_state != kConnected && _state != kDisconnecting) return;
+  if (!pause_if_over_memory_limit()) apply_reading();
+}
+
+void TcpConnection::connect_established() {
+  _loop->assert_in_loop_thread();
+  assert(_state == kConnecting);
+  set_state(kConnected);
+  _channel->tie(shared_from_this());
+  if (_completion_mode_requested) {
+    IoUringPoller *uring = _loop->io_uring_poller();
+    if (uring && uring->enable_completion_mode()) {
+      _uring = uring;
+    } else {
+      LOG(WARNING) << "TcpConnection[" << _name << "] completion mode needs io_uring poller, use readiness mode";
+    }
+  }
+  if (_uring) {
+    start_recv();
+  } else {
+    if (_edge_triggered_requested) {
+      if (_loop->supports_edge_triggered()) {
+        _channel->set_edge_triggered(true);
+      } else {
+        LOG(WARNING) << "TcpConnection[" << _name << "] poller " << _loop->poller_name()
+                     << " doesn't support edge-triggered mode, use level-triggered";
+      }
+    }
+    _channel->enable_reading();
+    if (_channel->edge_triggered()) {
+      _channel->enable_writing();
+    }
+  }
+  if (_idle_manager) _idle_manager->add(this);
+  _connection_callback(shared_from_this());
+}
+
+void TcpConnection::connect_destroyed() {
+  _loop->assert_in_loop_thread();
+  if (_state == kConnected) {
+    set_state(kDisconnected);
+    _channel->disable_all();
+    cancel_completion_ops();
+    _connection_callback(shared_from_this());
+  }
+  stop_idle_tracking();
+  _channel->remove();
+}
+
+void TcpConnection::handle_read(Timestamp receive_time) {
+  _loop->assert_in_loop_thread();
+  if (_channel->edge_triggered()) {
+    handle_read_edge_triggered(receive_time);
+    return;
+  }
+  if (pause_if_over_memory_limit()) return;
+  int     saved_errno = 0;
+  borrow_input_storage();
+  ssize_t n = _input_buffer.read_fd(_channel->fd(), &saved_errno);
+  if (n > 0) {
+    touch_idle();
+    _message_callback(shared_from_this(), &_input_buffer, receive_time);
+    release_input_storage();
+  } else if (n == 0) {
+    release_input_storage();
+    handle_close();
+  } else {
+    release_input_storage();
+    errno = saved_errno;
+    LOG(ERROR) << "TcpConnection::handle_read";
+    handle_error();
+  }
+}
+
+// 每读到一次数据就回调一次，和水平触发时一样，输入缓冲区不会因为一直读而无限增长
+// 回调中stop_read了(或者内存超限暂停了)就停下来，重新关注可读事件时epoll会再检查一次，剩下的数据不会丢
+// 对端一直在发送时可能永远读不到EAGAIN，读了kMaxReadsPerEvent次之后把剩下的放到pending functors中继续，
+// 让同一轮的其他连接、定时器先得到处理，这期间不会再有新的边沿通知，所以必须由自己接着读
+void TcpConnection::handle_read_edge_triggered(Timestamp receive_time) {
+  const int kMaxReadsPerEvent = 16;
+  for (int reads = 0; _reading && _state != kDisconnected; ++reads) {
+    if (pause_if_over_memory_limit()) return;
+    if (reads == kMaxReadsPerEvent) {
+      _loop->queue_in_loop([ self = shared_from_this() ] {
+        if (self->_state != kDisconnected) self->handle_read_edge_triggered(self->_loop->now());
+      });
+      return;
+    }
+    int saved_errno = 0;
+    borrow_input_storage();
+    ssize_t n = _input_buffer.read_fd(_channel->fd(), &saved_errno);
+    if (n > 0) {
+      touch_idle();
+      _message_callback(shared_from_this(), &_input_buffer, receive_time);
+      release_input_storage();
+      continue;
+    }
+    // 没读到数据(包括每次最后的EAGAIN)，借来的存储立即还回去
+    release_input_storage();
+    if (n == 0) {
+      handle_close();
+      return;
+    } else if (saved_errno == EINTR) {
+      continue;
+    } else {
+      if (saved_errno != EAGAIN && saved_errno != EWOULDBLOCK) {
+        errno = saved_errno;
+        LOG(ERROR) << "TcpConnection::handle_read";
+        handle_error();
+      }
+      return;
+    }
+  }
+}
+
+void TcpConnection::handle_write() {
+  _loop->assert_in_loop_thread();
+  if (_channel->edge_triggered()) {
+    handle_write_edge_triggered();
+    return;
+  }
+  if (!_channel->is_writing()) {
+    LOG(INFO) << "Connection fd = " << _channel->fd() << " is down, no more writing";
+    return;
+  }
+  int     saved_errno = 0;
+  ssize_t n = _output_buffer.write_fd(_channel->fd(), &saved_errno);
+  if (n > 0) {
+    if (_output_buffer.empty()) {
+      _channel->disable_writing();
+      write_completed();
+    }
+  } else {
+    errno = saved_errno;
+    LOG(ERROR) << "TcpConnection::handle_write";
+  }
+}
+
+// 可读事件也会带着POLLOUT一起通知，输出缓冲区为空时什么都不做
+void TcpConnection::handle_write_edge_triggered() {
+  if (_state == kDisconnected || _output_buffer.empty()) return;
+  while (!_output_buffer.empty()) {
+    int     saved_errno = 0;
+    ssize_t n = _output_buffer.write_fd(_channel->fd(), &saved_errno);
+    if (n > 0) {
+      continue;
+    } else if (n < 0 && saved_errno == EINTR) {
+      continue;
+    } else {
+      if (n < 0 && saved_errno != EAGAIN && saved_errno != EWOULDBLOCK) {
+        errno = saved_errno;
+        LOG(ERROR) << "TcpConnection::handle_write";
+      }
+      return;
+    }
+  }
+  write_completed();
+}
+
+// 输出缓冲区中的数据全部写出去了
+void TcpConnection::write_completed() {
+  if (_write_complete_callback) {
+    _loop->queue_in_loop(std::bind(_write_complete_callback, shared_from_this()));
+  }
+  if (_state == kDisconnecting) {
+    shutdown_in_loop();
+  }
+}
+
+// 读之前借一个chunk，读到的数据在回调中全部处理完之后立即还回去，空闲的连接不占用输入缓冲区
+// 数据超过chunk大小时Buffer换成从pool分配的更大的存储(计入内存上限)，处理完同样释放
+void TcpConnection::borrow_input_storage() {
+  if (!_input_buffer.has_storage()) _input_buffer.borrow_from(_chunk_pool.get());
+}
+
+void TcpConnection::release_input_storage() {
+  if (_input_buffer.readable_bytes() == 0 && _input_buffer.has_storage()) _input_buffer.release_storage();
+}
+
+void TcpConnection::touch_idle() {
+  if (_idle_manager) _idle_manager->touch(this);
+}
+
+void TcpConnection::stop_idle_tracking() {
+  if (_idle_manager) {
+    _idle_manager->remove(this);
+    _idle_manager = nullptr;
+  }
+}
+
+void TcpConnection::handle_close() {
+  _loop->assert_in_loop_thread();
+  LOG(INFO) << "fd = " << _channel->fd() << " state = " << state_to_string();
+  assert(_state == kConnected || _state == kDisconnecting);
+  // we don't close fd, leave it to dtor, so we can find leaks easily.
+  set_state(kDisconnected);
+  _channel->disable_all();
+  cancel_completion_ops();
+  stop_idle_tracking();
+
+  auto guard_this = shared_from_this();
+  _connection_callback(guard_this);
+  // must be the last line
+  _close_callback(guard_this);
+}
+
+void TcpConnection::handle_error() {
+  int err = sockets::get_socket_error(_channel->fd());
+  LOG(ERROR) << "TcpConnection::handle_error [" << _name << "] - SO_ERROR = " << err << " " << strerror(err);
+}
+
+// 提交multishot recv，完成事件的回调持有shared_ptr，保证连接和socket在操作结束之前不被析构
+void TcpConnection::start_recv() {
+  _recv_op = _uring->recv_multishot(_channel->fd(), [ self = shared_from_this() ](int res, uint32_t flags) {
+    self->handle_recv_completion(res, flags);
+  });
+}
+
+// 把输出缓冲区头部最多kMaxIov段交给内核发送，发送期间新的数据继续追加到尾部，已经交出去的数据不会被修改
+void TcpConnection::start_send() {
+  assert(_send_op == 0);
+  if (!_send_request) _send_request.reset(new SendRequest);
+  SendRequest *req = _send_request.get();
+  memset(&req->msg, 0x00, sizeof req->msg);
+  req->msg.msg_iov = req->iov;
+  req->msg.msg_iovlen = _output_buffer.fill_iovec(req->iov, SendRequest::kMaxIov);
+  _send_op = _uring->sendmsg(_channel->fd(), &req->msg,
+                             [ self = shared_from_this() ](int res, uint32_t) { self->handle_send_completion(res); });
+}
+
+void TcpConnection::cancel_completion_ops() {
+  if (!_uring) return;
+  if (_recv_op != 0) _uring->cancel(_recv_op);
+  if (_send_op != 0) _uring->cancel(_send_op);
+}
+
+void TcpConnection::handle_recv_completion(int res, uint32_t flags) {
+  _loop->assert_in_loop_thread();
+  const bool more = flags & IORING_CQE_F_MORE;
+  if (!more) _recv_op = 0;
+  if (res > 0) {
+    assert(flags & IORING_CQE_F_BUFFER);
+    uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+    // handle_close取消recv之前内核已经收到的数据，连接不会再处理输入，只归还provided buffer
+    if (_state == kDisconnected) {
+      _uring->recycle_buffer(bid);
+      return;
+    }
+    borrow_input_storage();
+    _input_buffer.append(_uring->provided_buffer(bid), static_cast<size_t>(res));
+    _uring->recycle_buffer(bid);
+    touch_idle();
+    _message_callback(shared_from_this(), &_input_buffer, _loop->now());
+    release_input_storage();
+    // 内核已经读到provided buffer中的数据不能丢，处理完之后再暂停
+    if (_state != kDisconnected) pause_if_over_memory_limit();
+  } else if (res == 0) {
+    if (_state == kConnected || _state == kDisconnecting) handle_close();
+    return;
+  } else if (res != -ECANCELED && res != -ENOBUFS) {
+    if (_state == kConnected || _state == kDisconnecting) {
+      LOG(ERROR) << "TcpConnection::handle_recv_completion [" << _name << "] - " << strerror(-res);
+      handle_close();
+    }
+    return;
+  }
+  // 内核结束了multishot(比如provided buffer暂时用完)，还需要读就重新提交
+  if (!more && _reading && !_memory_paused && (_state == kConnected || _state == kDisconnecting) && _recv_op == 0) {
+    start_recv();
+  }
+}
+
+void TcpConnection::handle_send_completion(int res) {
+  _loop->assert_in_loop_thread();
+  _send_op = 0;
+  if (_state == kDisconnected) return;
+  if (res < 0) {
+    if (res != -ECANCELED) {
+      LOG(ERROR) << "TcpConnection::handle_send_completion [" << _name << "] - " << strerror(-res);
+    }
+    _output_buffer.retrieve_all();
+    return;
+  }
+  _output_buffer.retrieve(static_cast<size_t>(res));
+  if (!_output_buffer.empty()) {
+    // 只发送了一部分，或者发送期间又有新的数据
+    start_send();
+    return;
+  }
+  if (_write_complete_callback) {
+    _loop->queue_in_loop(std::bind(_write_complete_callback, shared_from_this()));
+  }
+  if (_state == kDisconnecting) {
+    shutdown_in_loop();
+  }
+}
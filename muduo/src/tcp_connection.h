@@ -2,27 +2,145 @@
 
 #include <any>
 #include <boost/noncopyable.hpp>
+#include <memory>
 #include <string>
+#include <string_view>
 
 #include "buffer.h"
 #include "callbacks.h"
+#include "channel.h"
+#include "inet_address.h"
+#include "output_chain.h"
+#include "payload.h"
 
 // strcut tcp_info is in <netinet/tcp.h>
 struct tcp_info;
 
 namespace muduo {
-class Channel;
+class ChunkPool;
 class EventLoop;
+class IdleTimeoutManager;
+class IoUringPoller;
 class Socket;
 
+// TCP连接，服务端和客户端共用
+// 生命周期由shared_ptr管理，TcpServer持有一份，回调期间通过Channel::tie延长生命周期
+//
+// 默认是就绪模式：poller通知可读/可写之后用read/write收发数据。
+// 就绪模式下如果在connect_established之前调用了set_edge_triggered(true)，并且poller支持(epoll)，就使用边沿触发：
+// 可读时一直读到EAGAIN，可写事件从建立连接起一直关注，输出缓冲区有数据时一直写到EAGAIN，
+// 不再随着输出缓冲区清空/非空反复修改关注的事件。
+// 如果在connect_established之前调用了set_completion_mode(true)，并且所在loop的poller是io_uring，
+// 就使用完成模式：数据由multishot recv收进内核选择的provided buffer，再拷贝到_input_buffer，
+// 每次事件不需要read(2)；发送时直接提交send的SQE，不需要先等POLLOUT。两种模式下回调的签名和语义相同。
 class TcpConnection : public boost::noncopyable, public std::enable_shared_from_this<TcpConnection> {
+  friend class IdleTimeoutManager;
+
 public:
+  // 使用已经连接好的sockfd构造
+  TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &local_addr,
+                const InetAddress &peer_addr);
+  ~TcpConnection();
+
+  EventLoop         *get_loop() const { return _loop; }
+  const std::string &name() const { return _name; }
+  const InetAddress &local_address() const { return _local_addr; }
+  const InetAddress &peer_address() const { return _peer_addr; }
+  bool               connected() const { return _state == kConnected; }
+  bool               disconnected() const { return _state == kDisconnected; }
+  bool               get_tcp_info(struct tcp_info *) const;
+  std::string        get_tcp_info_string() const;
+
+  // 线程安全
+  void send(const void *data, size_t len);
+  void send(std::string_view message);
+  void send(Buffer *buf); // 发送之后清空buf
+  // 线程安全，不拷贝data，data在owner释放之前必须保持有效，发送完或者连接断开之后释放owner
+  // 适合把同一份数据发给很多连接，见OutputChain
+  void send_slice(std::string_view data, std::shared_ptr<const void> owner);
+  // 线程安全，不拷贝，引用同一份payload
+  void send(const Payload &payload) { send_slice(payload.view(), payload.owner()); }
+  void shutdown();        // 线程安全，发送完剩余的数据之后关闭写端
+  void force_close();
+  void set_tcp_no_delay(bool on);
+  void start_read();
+  void stop_read();
+  bool is_reading() const { return _reading; } // NOT thread safe
+
+  // 必须在connect_established之前设置
+  void set_completion_mode(bool on) { _completion_mode_requested = on; }
+  bool completion_mode() const { return _uring != nullptr; }
+  // 必须在connect_established之前设置，完成模式优先
+  void set_edge_triggered(bool on) { _edge_triggered_requested = on; }
+  bool edge_triggered() const;
+  // 线程安全，在loop线程中设置socket的Channel的优先级，比如让控制连接不被同一个loop上大流量的连接拖慢
+  // 只影响就绪模式下活动Channel的处理顺序，完成模式下的完成事件不经过Channel
+  void              set_priority(Channel::Priority priority);
+  Channel::Priority priority() const; // NOT thread safe
+  // 必须在connect_established之前设置，建立连接后加入manager，收到数据时touch，关闭后移除
+  void set_idle_timeout_manager(IdleTimeoutManager *manager) { _idle_manager = manager; }
+
+  void            set_context(const std::any &context) { _context = context; }
+  const std::any &get_context() const { return _context; }
+  std::any       *get_mutable_context() { return &_context; }
+
+  void set_connection_callback(const ConnectionCallback &cb) { _connection_callback = cb; }
+  void set_message_callback(const MessageCallback &cb) { _message_callback = cb; }
+  void set_write_complete_callback(const WriteCompleteCallback &cb) { _write_complete_callback = cb; }
+  void set_high_water_mark_callback(const HighWaterMarkCallback &cb, size_t high_water_mark) {
+    _high_water_mark_callback = cb;
+    _high_water_mark = high_water_mark;
+  }
+  // internal use only
+  void set_close_callback(const CloseCallback &cb) { _close_callback = cb; }
+
+  Buffer      *input_buffer() { return &_input_buffer; }
+  OutputChain *output_buffer() { return &_output_buffer; }
+
+  // 被TcpServer在loop线程中调用，只调用一次
+  void connect_established();
+  void connect_destroyed();
+
 private:
   enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
+  void        handle_read(Timestamp receive_time);
+  void        handle_read_edge_triggered(Timestamp receive_time);
+  void        handle_write_edge_triggered();
+  void        handle_write();
+  void        handle_close();
+  void        handle_error();
+  void        send_in_loop(std::string_view message);
+  // owner不为空时写不完的数据作为slice留在输出缓冲区中，不拷贝
+  void        send_in_loop(const void *data, size_t len, std::shared_ptr<const void> owner = nullptr);
+  void        shutdown_in_loop();
+  void        force_close_in_loop();
+  void        start_read_in_loop();
+  void        stop_read_in_loop();
+  void        apply_reading();
+  bool        pause_if_over_memory_limit();
+  void        resume_after_memory_limit();
+  void        set_state(StateE s) { _state = s; }
+  const char *state_to_string() const;
+  size_t      pending_output_bytes() const { return _output_buffer.readable_bytes(); }
+  bool        waiting_writable() const; // 就绪模式下输出缓冲区中是否有数据在等socket可写
+  void        write_completed();
+  void        borrow_input_storage();
+  void        release_input_storage();
+  void        touch_idle();
+  void        stop_idle_tracking();
+
+  // 完成模式
+  void start_recv();
+  void start_send();
+  void cancel_completion_ops();
+  void handle_recv_completion(int res, uint32_t flags);
+  void handle_send_completion(int res);
+
   EventLoop        *_loop;
   const std::string _name;
   StateE            _state; // TODO: use atomic variable
   bool              _reading;
+  bool              _memory_paused; // 缓冲区总量超过ChunkPool的全局上限，暂停读，和_reading互不影响
 
   // we don't expose those classes to client.
   std::unique_ptr<Socket>  _socket;
@@ -36,9 +154,28 @@ private:
   HighWaterMarkCallback _high_water_mark_callback;
   CloseCallback         _close_callback;
 
-  size_t   _high_water_mark;
-  Buffer   _input_buffer;
-  Buffer   _output_buffer; // FIXME: use list<Buffer> as output buffer
-  std::any _context;
+  // 输入输出缓冲区从所在loop的chunk池借存储，持有shared_ptr保证连接析构时还能归还
+  // 输入缓冲区只在有数据没处理完时持有存储，见borrow_input_storage
+  std::shared_ptr<ChunkPool> _chunk_pool;
+  size_t                     _high_water_mark;
+  Buffer                     _input_buffer;
+  OutputChain                _output_buffer;
+  std::any                   _context;
+  bool                       _edge_triggered_requested;
+
+  // 完成模式，_uring为nullptr表示就绪模式
+  struct SendRequest;
+  bool                         _completion_mode_requested;
+  IoUringPoller               *_uring;
+  uint64_t                     _recv_op;      // 进行中的multishot recv，0表示没有
+  uint64_t                     _send_op;      // 进行中的sendmsg，0表示没有，同一时刻最多一个
+  std::unique_ptr<SendRequest> _send_request; // 进行中的sendmsg的msghdr和iovec，第一次发送时分配
+
+  // IdleTimeoutManager中的链表节点和所在的桶，-1表示不在桶中
+  IdleTimeoutManager *_idle_manager = nullptr;
+  TcpConnection      *_idle_prev = nullptr;
+  TcpConnection      *_idle_next = nullptr;
+  int                 _idle_bucket = -1;
+  int64_t             _idle_last_active_us = 0;
 };
 } // namespace muduo
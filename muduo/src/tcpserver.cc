@@ -4,6 +4,7 @@
 
 #include "acceptor.h"
 #include "event_loop.h"
+#include "idle_timeout_manager.h"
 #include "inet_address.h"
 #include "sockops.h"
 
@@ -13,7 +14,10 @@ TcpServer::TcpServer(EventLoop *acceptor_loop, const InetAddress &listen_addr, c
     : _acceptor_loop(acceptor_loop)
     , _acceptor(new Acceptor(acceptor_loop, listen_addr))
     , _ip_port(listen_addr.to_ip_port())
-    , _name(name) {
+    , _name(name)
+    , _thread_pool(new EventLoopThreadPool(acceptor_loop, name))
+    , _connection_callback(default_connection_callback)
+    , _message_callback(default_message_callback) {
   _acceptor->set_new_connection_callback(
     std::bind(&TcpServer::new_connection, this, std::placeholders::_1, std::placeholders::_2));
 }
@@ -25,19 +29,47 @@ TcpServer::~TcpServer() {
   for (auto &item : _connections) {
     auto conn = item.second; // 拷贝shared_ptr指针
     item.second.reset();     // 重置shared_ptr指针
-    conn->get_loop()->run_in_loop(std::bind(&TcpConnection::connect_destroyed, conn));
+    ConnectionSet *conns = _loop_connections.at(conn->get_loop()).get();
+    conn->get_loop()->run_in_loop([ conn, conns ] {
+      conns->erase(conn);
+      conn->connect_destroyed();
+    });
+  }
+  // 排在上面的connect_destroyed之后，manager析构时这个server的连接都已经移除了
+  for (auto &item : _idle_managers) {
+    IdleTimeoutManager *manager = item.second.release();
+    item.first->run_in_loop([ manager ] { delete manager; });
+  }
+  // 同样排在之前投递的broadcast之后
+  for (auto &item : _loop_connections) {
+    ConnectionSet *conns = item.second.release();
+    item.first->run_in_loop([ conns ] { delete conns; });
   }
 }
 
 void TcpServer::start() {
   if (_started.fetch_sub(1) == 1) {
     _thread_pool->start(_thread_init_callback);
+    for (EventLoop *loop : _thread_pool->get_all_loops()) {
+      _loop_connections[ loop ] = std::make_unique<ConnectionSet>();
+    }
+    if (_idle_timeout_seconds > 0) {
+      for (EventLoop *loop : _thread_pool->get_all_loops()) {
+        _idle_managers[ loop ] = std::make_unique<IdleTimeoutManager>(loop, _idle_timeout_seconds);
+      }
+    }
     assert(!_acceptor->listening());
     // TODO:为什么要在loop线程中运行呢？
     _acceptor_loop->run_in_loop(std::bind(&Acceptor::listen, _acceptor.get()));
   }
 }
 
+void TcpServer::set_edge_triggered(bool on) {
+  assert(!_acceptor->listening());
+  _edge_triggered = on;
+  _acceptor->set_edge_triggered(on);
+}
+
 void TcpServer::new_connection(int connfd, const InetAddress &peer_addr) {
   // 由于new_connection函数是在Acceptor的loop线程中调用的，Accetptor中的loop对象和这里的this->_acceptor_loop是同一个
   _acceptor_loop->assert_in_loop_thread();
@@ -47,7 +79,7 @@ void TcpServer::new_connection(int connfd, const InetAddress &peer_addr) {
   snprintf(buf, sizeof buf, "-%s#%ld", _ip_port.c_str(), _conn_id);
   std::string conn_name = _name + buf;
   LOG(INFO) << "TcpServer::new_connection server_name[" << _name << "], conn_name[" << conn_name << "], connfd["
-            << connfd << "], from[" << perr_addr.to_ip_port() << "]";
+            << connfd << "], from[" << peer_addr.to_ip_port() << "]";
   InetAddress local_addr(sockets::get_local_addr(connfd));
   // TODO: poll with zero timeout to double confirm the new connection
   // TODO: use make_shared if necessary
@@ -57,8 +89,25 @@ void TcpServer::new_connection(int connfd, const InetAddress &peer_addr) {
   conn->set_connection_callback(_connection_callback);
   conn->set_message_callback(_message_callback);
   conn->set_write_complete_callback(_write_complete_callback);
+  conn->set_completion_mode(_completion_mode);
+  conn->set_edge_triggered(_edge_triggered);
+  if (_idle_timeout_seconds > 0) conn->set_idle_timeout_manager(_idle_managers[ next_loop ].get());
   conn->set_close_callback(std::bind(&TcpServer::remove_connection, this, std::placeholders::_1)); // FIXME: unsafe
-  next_loop->run_in_loop(std::bind(&TcpConnection::connect_established, conn));
+  ConnectionSet *conns = _loop_connections.at(next_loop).get();
+  next_loop->run_in_loop([ conn, conns ] {
+    conns->insert(conn);
+    conn->connect_established();
+  });
+}
+
+void TcpServer::broadcast(const Payload &payload) {
+  assert(_started.load() != 1);
+  for (auto &item : _loop_connections) {
+    ConnectionSet *conns = item.second.get();
+    item.first->run_in_loop([ conns, payload ] {
+      for (const auto &conn : *conns) conn->send(payload);
+    });
+  }
 }
 
 void TcpServer::remove_connection(const std::shared_ptr<TcpConnection> &conn) {
@@ -66,13 +115,17 @@ void TcpServer::remove_connection(const std::shared_ptr<TcpConnection> &conn) {
   _acceptor_loop->run_in_loop(std::bind(&TcpServer::remove_connection_in_loop, this, conn));
 }
 
-void TcpServer::remove_connection_in_loop(const std::shread_ptr<TcpConnection> &conn) {
+void TcpServer::remove_connection_in_loop(const std::shared_ptr<TcpConnection> &conn) {
   _acceptor_loop->assert_in_loop_thread();
   LOG(INFO) << "TcpServer::remove_connection_in_loop server_name[" << _name << "], conn_name[" << conn->name();
   // 也是因为在io线程中运行，所以是线程安全的
   size_t n = _connections.erase(conn->name());
   (void)n;
   assert(n == 1);
-  auto *ioloop = conn->get_loop();
-  ioloop->queue_in_loop(std::bind(&TcpConnection::connect_destroyed, conn));
+  auto          *ioloop = conn->get_loop();
+  ConnectionSet *conns = _loop_connections.at(ioloop).get();
+  ioloop->queue_in_loop([ conn, conns ] {
+    conns->erase(conn);
+    conn->connect_destroyed();
+  });
 }
\ No newline at end of file
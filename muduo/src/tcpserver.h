@@ -5,15 +5,20 @@
 #include <atomic>
 #include <boost/noncopyable.hpp>
 #include <functional>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 
 #include "callbacks.h"
 #include "event_loop_threadpool.h"
+#include "payload.h"
+#include "tcp_connection.h"
 
 namespace muduo {
 
 class EventLoop;
+class IdleTimeoutManager;
 class InetAddress;
 class Acceptor;
 
@@ -37,16 +42,35 @@ public:
   // not thread-safe
   void set_write_complete_callback(const WriteCompleteCallback &cb) { _write_complete_callback = cb; }
   void set_thread_init_callback(const ThreadInitCallback &cb) { _thread_init_callback = std::move(cb); }
+  // not thread-safe，对之后建立的连接生效
+  // 打开后，所在loop的poller是io_uring的连接使用完成模式收发数据，否则仍然是就绪模式，见TcpConnection
+  void set_completion_mode(bool on) { _completion_mode = on; }
+  // not thread-safe，必须在start之前调用
+  // 打开后监听socket和之后建立的连接在poller支持时(epoll)使用边沿触发，见TcpConnection
+  void set_edge_triggered(bool on);
+  // not thread-safe，必须在start之前调用
+  // 大于0时，连接超过seconds秒没有收到数据就强制关闭，每个loop一个IdleTimeoutManager
+  void set_idle_timeout(int seconds) {
+    assert(0 <= seconds && _started == 1);
+    _idle_timeout_seconds = seconds;
+  }
   // valid after calling start
   std::shared_ptr<EventLoopThreadPool> thread_pool() { return _thread_pool; }
   // 调用多次start没问题，且是线程安全的
   void start();
+  // 线程安全，start之后调用
+  // 把payload发给当前所有的连接：每个loop投递一个任务，在loop中发给这个loop上的连接，各个loop并行发送，
+  // 所有连接共用同一份数据，不拷贝(见Payload)。不等待发送完成
+  void broadcast(const Payload &payload);
 
   EventLoop         *get_loop() const { return _acceptor_loop; }
   const std::string  get_ip_port() const { return _ip_port; }
   const std::string &get_name() const { return _name; }
 
 private:
+  // 一个loop上的连接，只在这个loop线程中访问
+  using ConnectionSet = std::set<std::shared_ptr<TcpConnection>>;
+
   // 被Acceptor回调，非线程安全，在loop中调用是线程安全的
   void new_connection(int sockfd, const InetAddress &peer_addr);
   // thread-safe
@@ -63,6 +87,12 @@ private:
   std::shared_ptr<EventLoopThreadPool> _thread_pool;
   std::atomic<int32_t>                 _started{1};
   int64_t                              _conn_id{0};
+  bool                                 _completion_mode{false};
+  bool                                 _edge_triggered{false};
+  int                                  _idle_timeout_seconds{0};
+  // start之后只读，在各自的loop线程中析构
+  std::map<EventLoop *, std::unique_ptr<IdleTimeoutManager>> _idle_managers;
+  std::map<EventLoop *, std::unique_ptr<ConnectionSet>>      _loop_connections;
   // TODO: Q: 如何保证对_connections的读写是线程安全的？
   std::map<std::string, std::shared_ptr<TcpConnection>> _connections;
 
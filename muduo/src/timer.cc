@@ -2,8 +2,6 @@
 
 using namespace muduo;
 
-std::atomic<int64_t> Timer::_s_num_created;
-
 void Timer::restart(Timestamp now) {
   if (_repeat) {
     now += _interval;
@@ -1,58 +1,76 @@
 #pragma once
 
-#include <atomic>
-#include <functional>
+#include <stdint.h>
 
+#include "callbacks.h"
 #include "timestamp.h"
 
 namespace muduo {
 
-class Timer;
 class TimerQueue;
 
+// 定时器在所属TimerQueue的TimerSlab中的下标和generation
+// 定时器到期或者被取消之后槽会被复用，generation随之改变，过期的TimerId不会误取消新的定时器
+// generation从1开始，默认构造的TimerId不对应任何定时器
 class TimerId {
   friend class TimerQueue;
 
 public:
   TimerId()
-      : _timer(nullptr)
-      , _sequence(0) {}
-  TimerId(Timer *timer, int64_t seq)
-      : _timer(timer)
-      , _sequence(seq) {}
+      : _index(0)
+      , _generation(0) {}
+  TimerId(uint32_t index, uint32_t generation)
+      : _index(index)
+      , _generation(generation) {}
 
-  Timer  *timer() const { return _timer; }
-  int64_t sequence() const { return _sequence; }
+  uint32_t index() const { return _index; }
+  uint32_t generation() const { return _generation; }
+  bool     valid() const { return _generation != 0; }
 
 private:
-  Timer  *_timer;
-  int64_t _sequence;
+  uint32_t _index;
+  uint32_t _generation;
 };
 
 class Timer {
+  friend class TimingWheel;
+
 public:
-  Timer(std::function<void()> cb, Timestamp when, double interval)
+  Timer(TimerId id, TimerCallback cb, Timestamp when, double interval, int64_t slack_us = 0)
       : _callback(std::move(cb))
       , _expiration(when)
       , _interval(interval)
       , _repeat(interval > 0.0)
-      , _sequence(++_s_num_created) {}
+      , _canceled(false)
+      , _slack_us(slack_us)
+      , _id(id) {}
 
-  void           run() const { _callback(); }
-  Timestamp      expiration() const { return _expiration; }
-  bool           repeat() const { return _repeat; }
-  int64_t        sequence() const { return _sequence; }
-  void           restart(Timestamp now);
-  static int64_t num_created() { return _s_num_created; }
+  void      run() const { _callback(); }
+  Timestamp expiration() const { return _expiration; }
+  // 允许的最晚执行时间，定时器在[expiration, deadline]中的任意时刻执行都可以，
+  // TimerQueue借此把时间窗口重叠的定时器合并到一次唤醒中
+  Timestamp deadline() const { return Timestamp(_expiration.ms_since_epoch() + _slack_us); }
+  int64_t   slack_us() const { return _slack_us; }
+  bool      repeat() const { return _repeat; }
+  TimerId   id() const { return _id; }
+  void      restart(Timestamp now);
+  // 在到期回调执行期间被取消(比如在自己的回调中)，执行完之后不再重新加入
+  void      cancel() { _canceled = true; }
+  bool      canceled() const { return _canceled; }
 
 private:
-  const std::function<void()> _callback;
-  Timestamp                   _expiration;
-  const double                _interval;
-  const bool                  _repeat;
-  const int64_t               _sequence;
+  const TimerCallback _callback;
+  Timestamp           _expiration;
+  const double        _interval;
+  const bool          _repeat;
+  bool                _canceled;
+  const int64_t       _slack_us;
+  const TimerId       _id;
 
-  static std::atomic<int64_t> _s_num_created;
+  // TimingWheel中的链表节点和所在的槽，-1表示不在时间轮中
+  Timer *_prev = nullptr;
+  Timer *_next = nullptr;
+  int    _slot = -1;
 };
 
 } // namespace muduo
\ No newline at end of file
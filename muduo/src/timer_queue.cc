@@ -6,6 +6,7 @@
 #include "current_thread.h"
 #include "event_loop.h"
 #include "timer.h"
+#include "timing_wheel.h"
 
 using namespace muduo;
 
@@ -32,51 +33,81 @@ void reset_timerfd(int timerfd, Timestamp expiration) {
   struct itimerspec old_value;
   memset(&new_value, 0x00, sizeof(new_value));
   memset(&old_value, 0x00, sizeof(old_value));
-  int64_t ms = expiration - Timestamp::now();
-  if (ms < 100) ms = 100; // micro-seconds not milli-seconds
-  new_value.it_value.tv_sec = static_cast<time_t>(ms / Timestamp::kMicroSecondsPerSecond);
-  new_value.it_value.tv_nsec = static_cast<uint64_t>((ms % Timestamp::kMicroSecondsPerSecond) * 1000);
+  // 最早的定时器可能已经到期(handle_read用的是poll返回时的时间)，这时尽快触发
+  // it_value全为0表示停止timerfd，所以至少设为1纳秒
+  Timestamp now = Timestamp::now();
+  int64_t   us = now < expiration ? expiration - now : 0;
+  new_value.it_value.tv_sec = static_cast<time_t>(us / Timestamp::kMicroSecondsPerSecond);
+  new_value.it_value.tv_nsec = static_cast<long>((us % Timestamp::kMicroSecondsPerSecond) * 1000);
+  if (us == 0) new_value.it_value.tv_nsec = 1;
   int ret = ::timerfd_settime(timerfd, 0, &new_value, &old_value);
   if (ret != 0) {
     LOG(FATAL) << "::timerfd_settime failed, when=" << expiration;
   }
 }
 
-TimerQueue::TimerQueue(EventLoop *loop)
+TimerQueue::TimerQueue(EventLoop *loop, bool use_timerfd, bool use_wheel)
     : _loop(loop)
-    , _timerfd(create_timerfd())
-    , _timerfd_channel(loop, _timerfd)
-    , _calling_expired_timers(false) {
-  _timerfd_channel.set_read_callback(std::bind(&TimerQueue::handle_read, this));
-  // we are always reading the timerfd, we disalarm it with timerfd_settime
-  _timerfd_channel.enable_reading();
+    , _timerfd(use_timerfd ? create_timerfd() : -1)
+    , _wheel(use_wheel ? new TimingWheel(Timestamp::now(), kWheelTickUs) : nullptr)
+    , _wakeups(0)
+    , _saved_wakeups(0) {
+  if (use_timerfd) {
+    _timerfd_channel.reset(new Channel(loop, _timerfd));
+    _timerfd_channel->set_read_callback(std::bind(&TimerQueue::handle_read, this));
+    _timerfd_channel->set_priority(Channel::kHighPriority);
+    // we are always reading the timerfd, we disalarm it with timerfd_settime
+    _timerfd_channel->enable_reading();
+  }
 }
 
 TimerQueue::~TimerQueue() {
-  _timerfd_channel.disable_all();
-  _timerfd_channel.remove();
-  ::close(_timerfd);
-  for (auto &entry : _timers) {
-    delete entry.second;
+  if (_timerfd_channel) {
+    _timerfd_channel->disable_all();
+    _timerfd_channel->remove();
+    ::close(_timerfd);
   }
+  // 还没有到期的定时器由_slab析构
+}
+
+Timestamp TimerQueue::next_expiration() const {
+  if (_wheel) return _wheel->next_expiration();
+  return _timers.empty() ? Timestamp() : _timers.begin()->first;
 }
 
+size_t TimerQueue::size() const { return _wheel ? _wheel->size() : _timers.size(); }
+
 // 添加定时器需要告诉我【何时触发】【定时器的重复间隔】和【定时器触发时的回调】
-TimerId TimerQueue::add_timer(Timestamp when, double interval, std::function<void()> timer_cb) {
-  // TODO: use unique_ptr
-  Timer *timer = new Timer(std::move(timer_cb), when, interval);
+// Timer直接构造在_slab的槽中，其他线程只需要把槽的下标交给loop线程
+TimerId TimerQueue::add_timer(Timestamp when, double interval, TimerCallback timer_cb, double slack) {
+  int64_t slack_us = slack > 0.0 ? static_cast<int64_t>(slack * Timestamp::kMicroSecondsPerSecond) : 0;
+  if (_loop->is_in_loop_thread()) {
+    TimerId id = _slab.allocate();
+    add_timer_in_loop(_slab.construct(id, std::move(timer_cb), when, interval, slack_us));
+    return id;
+  }
+  TimerId id = _slab.allocate_remote();
+  Timer  *timer = _slab.construct(id, std::move(timer_cb), when, interval, slack_us);
   // 在loop线程中执行真正的add_timer操作
-  _loop->run_in_loop(std::bind(&TimerQueue::add_timer_in_loop, this, timer));
-  return TimerId(timer, timer->sequence());
+  _loop->queue_in_loop([ this, timer ] {
+    _slab.refill_remote();
+    add_timer_in_loop(timer);
+  });
+  return id;
 }
 
 // 在loop线程中执行真正的add_timer操作
 void TimerQueue::add_timer_in_loop(Timer *timer) {
-  DLOG(INFO) << "call " << __func__ << " in loop thread";
   _loop->assert_in_loop_thread();
+  // 其他线程添加的定时器，在交给loop线程之前就已经被loop线程取消了
+  if (timer->canceled()) {
+    _slab.destroy(timer);
+    return;
+  }
   bool earliest_changed = insert(timer);
-  if (earliest_changed) {
-    reset_timerfd(_timerfd, timer->expiration());
+  // poll超时方式下，loop在下一次poll之前会重新计算超时时间
+  if (earliest_changed && uses_timerfd()) {
+    reset_timerfd(_timerfd, next_expiration());
   }
 }
 
@@ -84,113 +115,146 @@ void TimerQueue::add_timer_in_loop(Timer *timer) {
 // @return: 新加入的这个timer是否是最早的触发超时的timer，超时时间距离现在最近
 bool TimerQueue::insert(Timer *timer) {
   _loop->assert_in_loop_thread();
-  assert(_timers.size() == _active_timers.size());
+  if (_wheel) {
+    Timestamp earliest = _wheel->next_expiration();
+    _wheel->add(timer);
+    return !earliest.valid() || _wheel->next_expiration() < earliest;
+  }
+  // 按deadline排序，最早的deadline就是下一次必须唤醒的时间
   bool      earliest_changed = false;
-  Timestamp when = timer->expiration();
+  Timestamp when = timer->deadline();
   auto      it = _timers.begin();
   if (it == _timers.end() || when < it->first) {
     earliest_changed = true;
   }
-  {
-    auto result = _timers.insert(std::make_pair(when, timer));
-    assert(result.second);
-    (void)result;
-  }
-  {
-    auto result = _active_timers.insert({timer, timer->sequence()});
-    assert(result.second);
-    (void)result;
-  }
-  assert(_timers.size() == _active_timers.size());
+  auto result = _timers.insert(std::make_pair(when, timer));
+  assert(result.second);
+  (void)result;
   return earliest_changed;
 }
 
 // 非loop线程中调用
 void TimerQueue::cancel(TimerId timerid) { _loop->run_in_loop(std::bind(&TimerQueue::cancel_in_loop, this, timerid)); }
 
-// 在loop线程中执行，这个函数有可能在TimerQueue::handle_read中被调用
+// 在loop线程中执行，这个函数有可能在到期定时器的回调中被调用
+// 定时器已经到期或者被取消过时，id对应的槽generation已经变了，什么也不做
 void TimerQueue::cancel_in_loop(TimerId timerid) {
   _loop->assert_in_loop_thread();
-  assert(_timers.size() == _active_timers.size());
-  ActiveTimer timer(timerid.timer(), timerid.sequence());
-  auto        it = _active_timers.find(timer);
-  if (it != _active_timers.end()) {
-    size_t n = _timers.erase({it->first->expiration(), it->first});
-    assert(n == 1);
-    (void)n;
-    delete it->first; // FIXME: no delete
-    _active_timers.erase(it);
-  } else if (_calling_expired_timers) {
-    // TODO: WHY?
-    // 一方面，这个函数在TimerQueue::handle_read中被调用
-    // 另一方面，如果同一个timerid被cancel了2次，就把它放入_calceling_timers
-    _canceling_timers.insert(timer);
-  }
-  assert(_timers.size() == _active_timers.size());
+  Timer *timer = _slab.find(timerid);
+  if (timer == nullptr) return;
+  bool queued;
+  if (_wheel) {
+    queued = _wheel->contains(timer);
+    if (queued) _wheel->remove(timer);
+  } else {
+    queued = _timers.erase({timer->deadline(), timer}) == 1;
+  }
+  if (queued) {
+    _slab.destroy(timer);
+  } else {
+    // 不在队列中：正在执行的这一批到期定时器之一，执行完之后由reset回收；
+    // 或者是其他线程添加、还没有交给loop线程的定时器，由add_timer_in_loop回收
+    timer->cancel();
+  }
 }
 
 // _timerfd的超时时间到了，就调用handle_read，在I/O线程中调用
 // TODO: 如何让本函数在loop线程中执行？通过channel的handle_read
 void TimerQueue::handle_read() {
   _loop->assert_in_loop_thread();
-  auto now = Timestamp::now();
+  // timerfd是高优先级的channel，在poll返回后最先处理，直接用poll返回的时间
+  // 如果因此早了一点没有取到到期的定时器，reset会重新设置timerfd，不会丢失
+  auto now = _loop->now();
   read_timerfd(_timerfd, now);
+  run_expired(now);
+}
+
+// poll按最早的到期时间设置了超时，但poll也可能因为其他事件提前返回，这时没有到期的定时器
+void TimerQueue::handle_expired(Timestamp now) {
+  _loop->assert_in_loop_thread();
+  if (!has_expired(now)) return;
+  run_expired(now);
+}
+
+// 按deadline排序时，最早的deadline还没到，但它的到期时间已经过了，也可以顺便执行
+bool TimerQueue::has_expired(Timestamp now) const {
+  if (_wheel) {
+    Timestamp next = _wheel->next_expiration();
+    return next.valid() && !(now < next);
+  }
+  return !_timers.empty() && !(now < _timers.begin()->second->expiration());
+}
+
+void TimerQueue::run_expired(Timestamp now) {
   auto expired = get_expired(now);
-  _calling_expired_timers = true;
-  _canceling_timers.clear();
+  const bool stats_enabled = _loop->stats_enabled();
+  // poll超时模式下定时器回调不在任何Channel中执行，单独发布心跳标记，LoopWatchdog据此指出卡在定时器回调中
+  const bool heartbeat_enabled = _loop->_heartbeat_enabled.load(std::memory_order_relaxed);
+  int64_t    start_ns = stats_enabled ? monotonic_ns() : 0;
+  int64_t    saved = 0;
+  if (heartbeat_enabled) {
+    _loop->_heartbeat.timers.store(true, std::memory_order_relaxed);
+  }
   for (const auto &entry : expired) {
-    entry.second->run();
+    // 还没到自己的deadline，搭这一次唤醒执行，否则到deadline还要再唤醒一次
+    if (entry.second->slack_us() > 0 && now < entry.second->deadline()) ++saved;
+    // 可能被同一批中前面的回调取消了
+    if (!entry.second->canceled()) entry.second->run();
+  }
+  if (heartbeat_enabled) {
+    _loop->_heartbeat.timers.store(false, std::memory_order_relaxed);
+  }
+  if (stats_enabled) {
+    _loop->_stats.timers_ns.record(monotonic_ns() - start_ns);
+  }
+  if (!expired.empty()) {
+    // 整批都没到deadline(比如时间轮对齐到的tick)，其中一个仍然需要这次唤醒；I/O顺便带起的不区分，保守估计
+    if (saved == static_cast<int64_t>(expired.size())) --saved;
+    _wakeups.store(_wakeups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    _saved_wakeups.store(_saved_wakeups.load(std::memory_order_relaxed) + saved, std::memory_order_relaxed);
   }
-  _calling_expired_timers = false;
   reset(expired, now);
 }
 
 // 获取所有到期时间早于现在的timers，就是已经到期的timers
-// 将这些timers从_timers和_active_timers删除
+// 将这些timers从_timers删除
+// _timers按deadline排序，从头取到第一个还没到期的为止：deadline已过的一定都在这之前，
+// 后面到期时间已过、但deadline较晚的定时器留到下次
 // 在loop线程中执行
 std::vector<TimerQueue::Entry> TimerQueue::get_expired(Timestamp now) {
-  assert(_timers.size() == _active_timers.size());
   std::vector<Entry> expired;
-  Entry              sentry = std::make_pair(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
-  auto               it = _timers.lower_bound(sentry);
+  if (_wheel) {
+    std::vector<Timer *> timers;
+    _wheel->advance(now, &timers);
+    expired.reserve(timers.size());
+    for (Timer *timer : timers) {
+      expired.emplace_back(timer->expiration(), timer);
+    }
+    return expired;
+  }
+  auto it = _timers.begin();
+  while (it != _timers.end() && !(now < it->second->expiration())) ++it;
   assert(it == _timers.end() || now < it->first);
   std::copy(_timers.begin(), it, back_inserter(expired));
   _timers.erase(_timers.begin(), it);
-
-  for (const auto &entry : expired) {
-    ActiveTimer timer{entry.second, entry.second->sequence()};
-    auto        ret = _active_timers.erase(timer);
-    assert(ret == 1);
-    (void)ret;
-  }
-
-  assert(_timers.size() == _active_timers.size());
-
   return expired;
 }
 
 // 在loop线程中执行
 void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now) {
-  Timestamp next_expire;
   for (const Entry &elem : expired) {
-    ActiveTimer timer(elem.second, elem.second->sequence());
-
-    // TODO: 这里的_canceling_timers什么作用？
     // 这个已经到期的timer处理完了，并且对该timer执行了cancel了，那就意味着不需要在使用这个timer了，也不需要reset，再insert了
     // 所以在timer到期的回调里，可以直接执行cancel
-    if (elem.second->repeat() && _canceling_timers.find(timer) == _canceling_timers.end()) {
+    if (elem.second->repeat() && !elem.second->canceled()) {
       elem.second->restart(now);
       insert(elem.second);
     } else {
-      delete elem.second;
+      _slab.destroy(elem.second);
     }
   }
 
-  if (!_timers.empty()) {
-    next_expire = _timers.begin()->second->expiration();
-  }
-
-  if (next_expire.valid()) {
+  Timestamp next_expire = next_expiration();
+  if (next_expire.valid() && uses_timerfd()) {
     reset_timerfd(_timerfd, next_expire);
   }
 }
\ No newline at end of file
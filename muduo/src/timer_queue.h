@@ -1,10 +1,13 @@
 #pragma once
 
 #include <atomic>
-#include <functional>
+#include <memory>
 #include <set>
+#include <vector>
 
+#include "callbacks.h"
 #include "channel.h"
+#include "timer_slab.h"
 #include "timestamp.h"
 
 namespace muduo {
@@ -12,25 +15,61 @@ namespace muduo {
 class EventLoop;
 class TimerId;
 class Timer;
+class TimingWheel;
 
 // A best effort timer queue.
 // No guarantee that the callback will be on time.
 // TimerQueue所属的成员函数只能在其所属的I/O线程中调用，因此不必加锁
+//
+// 两种触发方式：
+// 1. timerfd：最早的定时器变化时用timerfd_settime重新设置，到期时timerfd可读，由Channel回调handle_read
+// 2. poll超时：不使用timerfd，EventLoop每轮把next_expiration()换算成poll的超时时间，poll返回后调用handle_expired，
+//    省掉一个fd、每次最早的定时器变化时的timerfd_settime和到期时额外的一次唤醒和read。
+//    需要poller支持微秒级的超时(epoll_pwait2或io_uring)，否则退回到timerfd
+//
+// 两种组织定时器的方式：
+// 1. std::set：按到期时间排序，精确，但每次添加、取消、到期都是O(log n)，还要分配set的节点
+// 2. 分层时间轮(TimingWheel)：添加、取消、到期都是O(1)，适合大量的连接空闲超时、请求超时，
+//    代价是最多晚kWheelTickUs触发
+//
+// 带slack的定时器可以在[到期时间, 到期时间 + slack]中的任意时刻执行(见Timer::deadline)。
+// std::set按deadline排序，在最早的deadline唤醒，顺便执行所有到期时间已过的定时器，
+// 因为其他定时器或者I/O提前唤醒时，到期时间已过的也一起执行；时间轮把它们对齐到窗口中的同一个tick。
+// 窗口重叠的定时器因此合并成一次唤醒，timerfd也只在最早的deadline变化时重新设置。
 class TimerQueue {
 public:
   typedef std::pair<Timestamp, Timer *> Entry;
   typedef std::set<Entry>               TimerSet;
-  typedef std::pair<Timer *, int64_t>   ActiveTimer;
-  typedef std::set<ActiveTimer>         ActiveTimerSet;
 
 public:
-  explicit TimerQueue(EventLoop *loop);
+  // 时间轮的tick
+  static const int64_t kWheelTickUs = 1000;
+
+  TimerQueue(EventLoop *loop, bool use_timerfd, bool use_wheel);
   ~TimerQueue();
 
   // must be thread safe, usually be called from other threads.
-  TimerId add_timer(Timestamp when, double interval, std::function<void()> timer_cb);
+  // slack单位为秒
+  TimerId add_timer(Timestamp when, double interval, TimerCallback timer_cb, double slack = 0.0);
   void    cancel(TimerId timerid);
 
+  bool        uses_timerfd() const { return _timerfd >= 0; }
+  const char *name() const { return _wheel ? "wheel" : "set"; }
+  // 以下只能在loop线程中调用
+  // 下一次必须唤醒的时间(最早的deadline)，没有定时器时返回invalid
+  // 时间轮返回的是下界，到这个时间可能没有定时器到期，handle_expired之后再重新取
+  Timestamp next_expiration() const;
+  // 是否有可以执行的定时器，可能早于next_expiration()
+  bool      has_expired(Timestamp now) const;
+  size_t    size() const;
+  // poll超时方式下由EventLoop在poll返回后调用，执行now之前到期的定时器
+  void handle_expired(Timestamp now);
+
+  // 执行到期定时器的次数(每次执行一批)，以及有slack的定时器搭其他唤醒提前执行、省掉的唤醒次数
+  // 可以在任意线程读取
+  int64_t wakeups() const { return _wakeups.load(std::memory_order_relaxed); }
+  int64_t saved_wakeups() const { return _saved_wakeups.load(std::memory_order_relaxed); }
+
 private:
   void add_timer_in_loop(Timer *timer);
   bool insert(Timer *);
@@ -38,18 +77,21 @@ private:
 
   // called when timerfd alarms
   void handle_read();
+  void run_expired(Timestamp now);
   // move out all expired timers
   std::vector<Entry> get_expired(Timestamp now);
   void               reset(const std::vector<Entry> &expired, Timestamp now);
 
 private:
-  EventLoop        *_loop;
-  const int         _timerfd;
-  Channel           _timerfd_channel;
-  TimerSet          _timers;        // timer list sorted by expiration
-  ActiveTimerSet    _active_timers; // for cancel()
-  std::atomic<bool> _calling_expired_timers;
-  ActiveTimerSet    _canceling_timers;
+  EventLoop               *_loop;
+  const int                _timerfd; // poll超时方式下为-1
+  std::unique_ptr<Channel> _timerfd_channel;
+  TimerSlab                _slab;   // 所有Timer对象的存储，TimerId是其中的下标
+  TimerSet                 _timers; // timer list sorted by expiration
+  // 时间轮方式下不用_timers
+  std::unique_ptr<TimingWheel> _wheel;
+  std::atomic<int64_t>         _wakeups;
+  std::atomic<int64_t>         _saved_wakeups;
 };
 
 } // namespace muduo
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "timer_slab.h"
+
+#include <assert.h>
+#include <glog/logging.h>
+
+#include <new>
+
+using namespace muduo;
+
+TimerSlab::TimerSlab()
+    : _num_chunks(0)
+    , _free_head(kNoSlot)
+    , _remote_free_size(0) {
+  for (auto &chunk : _chunks) {
+    chunk.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+// 还没有到期的定时器，以及其他线程已经构造、但还没来得及交给loop线程的定时器
+TimerSlab::~TimerSlab() {
+  for (int k = 0; k < _num_chunks; ++k) {
+    Slot    *chunk = _chunks[ k ].load(std::memory_order_relaxed);
+    uint32_t count = kFirstChunkSize << k;
+    for (uint32_t i = 0; i < count; ++i) {
+      if (chunk[ i ].constructed) {
+        reinterpret_cast<Timer *>(chunk[ i ].storage)->~Timer();
+      }
+    }
+    delete[] chunk;
+  }
+}
+
+uint32_t TimerSlab::grow(uint32_t *count) {
+  if (_num_chunks == kMaxChunks) {
+    LOG(FATAL) << "too many timers";
+  }
+  int      k = _num_chunks++;
+  uint32_t first = (kFirstChunkSize << k) - kFirstChunkSize;
+  *count = kFirstChunkSize << k;
+  Slot *chunk = new Slot[ *count ];
+  for (uint32_t i = 0; i < *count; ++i) {
+    chunk[ i ].generation = 1;
+    chunk[ i ].next_free = kNoSlot;
+    chunk[ i ].constructed = false;
+  }
+  _chunks[ k ].store(chunk, std::memory_order_release);
+  return first;
+}
+
+TimerId TimerSlab::allocate() {
+  if (_free_head == kNoSlot) {
+    uint32_t count;
+    uint32_t first;
+    {
+      std::lock_guard<std::mutex> lg(_mutex);
+      first = grow(&count);
+    }
+    for (uint32_t i = count; i > 0; --i) {
+      slot(first + i - 1)->next_free = _free_head;
+      _free_head = first + i - 1;
+    }
+  }
+  uint32_t index = _free_head;
+  Slot    *s = slot(index);
+  _free_head = s->next_free;
+  return TimerId(index, s->generation);
+}
+
+TimerId TimerSlab::allocate_remote() {
+  std::lock_guard<std::mutex> lg(_mutex);
+  if (_remote_free.empty()) {
+    // loop线程来不及补充，整块都留给其他线程
+    uint32_t count;
+    uint32_t first = grow(&count);
+    for (uint32_t i = count; i > 0; --i) {
+      _remote_free.push_back(first + i - 1);
+    }
+  }
+  uint32_t index = _remote_free.back();
+  _remote_free.pop_back();
+  _remote_free_size.store(_remote_free.size(), std::memory_order_relaxed);
+  return TimerId(index, slot(index)->generation);
+}
+
+Timer *TimerSlab::construct(TimerId id, TimerCallback cb, Timestamp when, double interval, int64_t slack_us) {
+  Slot *s = slot(id.index());
+  assert(!s->constructed && s->generation == id.generation());
+  Timer *timer = new (s->storage) Timer(id, std::move(cb), when, interval, slack_us);
+  s->constructed = true;
+  return timer;
+}
+
+Timer *TimerSlab::find(TimerId id) const {
+  if (!id.valid()) return nullptr;
+  uint64_t v = static_cast<uint64_t>(id.index()) + kFirstChunkSize;
+  int      k = 63 - __builtin_clzll(v) - kFirstChunkBits;
+  if (k >= kMaxChunks || _chunks[ k ].load(std::memory_order_acquire) == nullptr) return nullptr;
+  Slot *s = slot(id.index());
+  if (s->generation != id.generation() || !s->constructed) return nullptr;
+  return reinterpret_cast<Timer *>(s->storage);
+}
+
+void TimerSlab::destroy(Timer *timer) {
+  uint32_t index = timer->id().index();
+  Slot    *s = slot(index);
+  assert(s->constructed && reinterpret_cast<Timer *>(s->storage) == timer);
+  timer->~Timer();
+  s->constructed = false;
+  // 跳过0，保证默认构造的TimerId永远无效
+  if (++s->generation == 0) s->generation = 1;
+  s->next_free = _free_head;
+  _free_head = index;
+}
+
+void TimerSlab::refill_remote() {
+  if (_remote_free_size.load(std::memory_order_relaxed) >= kRemoteLowWater) return;
+  uint32_t batch[ kRemoteBatch ];
+  for (size_t i = 0; i < kRemoteBatch; ++i) {
+    batch[ i ] = allocate().index();
+  }
+  std::lock_guard<std::mutex> lg(_mutex);
+  _remote_free.insert(_remote_free.end(), batch, batch + kRemoteBatch);
+  _remote_free_size.store(_remote_free.size(), std::memory_order_relaxed);
+}
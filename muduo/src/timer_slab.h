@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "callbacks.h"
+#include "timer.h"
+
+namespace muduo {
+
+// 每个TimerQueue一个，存放Timer对象，代替每个定时器一次的new/delete
+//
+// 槽按块分配，第k块有kFirstChunkSize << k个槽，块只增加不释放，Timer的地址在整个生命周期内不变，
+// 块的个数固定上限，按下标定位块只需要一次bit运算，不需要加锁或者在扩容时搬移。
+// 每个槽有一个generation，槽被释放时加一，TimerId就是(下标, generation)，
+// 过期的TimerId(定时器已经到期或者被取消，槽可能已经被新的定时器复用)一次比较就能识别出来。
+//
+// loop线程从自己的空闲链表中分配，不加锁也没有原子操作。
+// 其他线程调用run_after等时，从一个加锁的后备列表中分配，由loop线程批量补充，不够时自己扩容。
+// 分配到的槽归分配它的线程所有，直到通过pending functor交给loop线程，所以可以在调用线程中构造Timer。
+class TimerSlab {
+public:
+  TimerSlab();
+  ~TimerSlab();
+
+  TimerSlab(const TimerSlab &) = delete;
+  TimerSlab &operator=(const TimerSlab &) = delete;
+
+  // 只能在loop线程中调用
+  TimerId allocate();
+  // 可以在任意线程中调用
+  TimerId allocate_remote();
+  // 由分配这个槽的线程调用
+  Timer *construct(TimerId id, TimerCallback cb, Timestamp when, double interval, int64_t slack_us = 0);
+
+  // 以下只能在loop线程中调用
+  // id过期(或者从未分配过)时返回nullptr
+  Timer *find(TimerId id) const;
+  // 析构Timer并回收槽，之前的TimerId全部失效
+  void   destroy(Timer *timer);
+  // 其他线程可用的后备槽不多时，从loop线程的空闲链表补充一批
+  void   refill_remote();
+
+private:
+  static const uint32_t kFirstChunkSize = 1024;
+  static const int      kFirstChunkBits = 10;
+  static const int      kMaxChunks = 22; // 总共约42亿个槽，覆盖uint32_t的下标
+  static const uint32_t kNoSlot = UINT32_MAX;
+  static const size_t   kRemoteLowWater = 16;
+  static const size_t   kRemoteBatch = 64;
+
+  struct Slot {
+    alignas(Timer) unsigned char storage[ sizeof(Timer) ];
+    uint32_t generation;
+    uint32_t next_free; // loop线程的空闲链表
+    bool     constructed;
+  };
+
+  Slot *slot(uint32_t index) const {
+    uint64_t v = static_cast<uint64_t>(index) + kFirstChunkSize;
+    int      k = 63 - __builtin_clzll(v) - kFirstChunkBits;
+    return _chunks[ k ].load(std::memory_order_acquire) + (v - (static_cast<uint64_t>(kFirstChunkSize) << k));
+  }
+  // 新增一块，返回第一个槽的下标和槽数，调用时持有_mutex
+  uint32_t grow(uint32_t *count);
+
+  std::atomic<Slot *> _chunks[ kMaxChunks ];
+  int                 _num_chunks; // 由_mutex保护
+  uint32_t            _free_head;  // loop线程的空闲链表
+
+  std::mutex            _mutex;
+  std::vector<uint32_t> _remote_free; // 由_mutex保护
+  std::atomic<size_t>   _remote_free_size;
+};
+
+} // namespace muduo
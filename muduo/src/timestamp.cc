@@ -1,6 +1,7 @@
 #include "timestamp.h"
 
 #include <sys/time.h>
+#include <time.h>
 
 using namespace muduo;
 
@@ -35,3 +36,10 @@ Timestamp Timestamp::now() {
   int64_t seconds = tv.tv_sec;
   return Timestamp(seconds * kMicroSecondsPerSecond + tv.tv_usec);
 }
+
+Timestamp Timestamp::now_coarse() {
+  struct timespec ts;
+  ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  int64_t seconds = ts.tv_sec;
+  return Timestamp(seconds * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
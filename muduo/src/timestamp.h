@@ -21,7 +21,10 @@ public:
     return *this;
   }
 
-  Timestamp operator+(double gap) { return operator+=(gap); }
+  Timestamp operator+(double gap) const {
+    Timestamp t(*this);
+    return t += gap;
+  }
 
   // compatable with STL
   void swap(Timestamp &other) {
@@ -36,6 +39,9 @@ public:
   time_t      seconds_since_epoch() const { return _ms_since_epoch / kMicroSecondsPerSecond; }
 
   static Timestamp now();
+  // 基于CLOCK_REALTIME_COARSE，精度只有一个tick(通常1~4ms)，但比now()便宜得多
+  // 适合打日志、统计、空闲超时之类不需要精确时间的场景
+  static Timestamp now_coarse();
   static Timestamp invalid() { return Timestamp(); }
   static Timestamp from_unix_time(time_t t) { return from_unix_time(t, 0); }
   static Timestamp from_unix_time(time_t t, uint64_t ms) {
@@ -0,0 +1,172 @@
+#include "timing_wheel.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "timer.h"
+
+using namespace muduo;
+
+TimingWheel::TimingWheel(Timestamp origin, int64_t tick_us)
+    : _origin(origin)
+    , _tick_us(tick_us)
+    , _now_tick(0)
+    , _size(0) {
+  assert(tick_us > 0);
+  memset(_occupied, 0x00, sizeof _occupied);
+  memset(_slots, 0x00, sizeof _slots);
+}
+
+// 向上取整，保证不会在到期时间之前触发
+uint64_t TimingWheel::tick_of(Timestamp when) const {
+  if (!(_origin < when)) return 0;
+  uint64_t us = when.ms_since_epoch() - _origin.ms_since_epoch();
+  return (us + _tick_us - 1) / _tick_us;
+}
+
+// 窗口[lo, hi]中低位0最多的tick：lo-1和hi第一个不同的位置为1、更低的位清0
+uint64_t TimingWheel::tick_of(const Timer *timer) const {
+  uint64_t lo = tick_of(timer->expiration());
+  if (timer->slack_us() == 0) return lo;
+  Timestamp deadline = timer->deadline();
+  uint64_t  hi = _origin < deadline ? (deadline.ms_since_epoch() - _origin.ms_since_epoch()) / _tick_us : 0;
+  if (hi <= lo || lo == 0) return lo;
+  uint64_t mask = (1ULL << (63 - __builtin_clzll((lo - 1) ^ hi))) - 1;
+  return hi & ~mask;
+}
+
+void TimingWheel::add(Timer *timer) {
+  assert(timer->_slot == -1);
+  place(timer);
+  ++_size;
+}
+
+void TimingWheel::remove(Timer *timer) {
+  assert(timer->_slot != -1);
+  unlink(timer);
+  --_size;
+}
+
+bool TimingWheel::contains(const Timer *timer) const { return timer->_slot != -1; }
+
+// 按到期tick和当前tick第一个不同的6位选择层，该层中的槽号一定大于当前tick在该层的槽号，
+// 所以每层的槽不会回绕，当前tick走到槽的起点时定时器还在同一个槽中
+void TimingWheel::place(Timer *timer) {
+  uint64_t tick = tick_of(timer);
+  if (tick <= _now_tick) {
+    link(kDueSlot, timer);
+    return;
+  }
+  int level = (63 - __builtin_clzll(tick ^ _now_tick)) / kSlotBits;
+  int index = static_cast<int>((tick >> (level * kSlotBits)) & (kSlotsPerLevel - 1));
+  link(level * kSlotsPerLevel + index, timer);
+}
+
+// 加到链表尾部，同一个槽中的定时器保持加入的顺序
+void TimingWheel::link(int slot, Timer *timer) {
+  Timer *&head = _slots[ slot ];
+  if (head == nullptr) {
+    timer->_prev = timer->_next = timer;
+    head = timer;
+    if (slot != kDueSlot) {
+      _occupied[ slot / kSlotsPerLevel ] |= 1ULL << (slot % kSlotsPerLevel);
+    }
+  } else {
+    Timer *tail = head->_prev;
+    timer->_prev = tail;
+    timer->_next = head;
+    tail->_next = timer;
+    head->_prev = timer;
+  }
+  timer->_slot = slot;
+}
+
+void TimingWheel::unlink(Timer *timer) {
+  int     slot = timer->_slot;
+  Timer *&head = _slots[ slot ];
+  if (timer->_next == timer) {
+    head = nullptr;
+    if (slot != kDueSlot) {
+      _occupied[ slot / kSlotsPerLevel ] &= ~(1ULL << (slot % kSlotsPerLevel));
+    }
+  } else {
+    timer->_prev->_next = timer->_next;
+    timer->_next->_prev = timer->_prev;
+    if (head == timer) head = timer->_next;
+  }
+  timer->_prev = timer->_next = nullptr;
+  timer->_slot = -1;
+}
+
+int TimingWheel::lowest_level() const {
+  for (int level = 0; level < kLevels; ++level) {
+    if (_occupied[ level ]) return level;
+  }
+  return -1;
+}
+
+uint64_t TimingWheel::slot_start(int level) const {
+  int      shift = level * kSlotBits;
+  int      index = __builtin_ctzll(_occupied[ level ]);
+  // 高于本层的位和当前tick相同，本层的位是槽号，低于本层的位是0
+  int      prefix_shift = shift + kSlotBits;
+  uint64_t prefix = prefix_shift >= 64 ? 0 : (_now_tick >> prefix_shift) << prefix_shift;
+  assert(index > static_cast<int>((_now_tick >> shift) & (kSlotsPerLevel - 1)));
+  return prefix | (static_cast<uint64_t>(index) << shift);
+}
+
+Timestamp TimingWheel::next_expiration() const {
+  if (_slots[ kDueSlot ]) {
+    return Timestamp(_origin.ms_since_epoch() + _now_tick * _tick_us);
+  }
+  int level = lowest_level();
+  if (level < 0) return Timestamp::invalid();
+  return Timestamp(_origin.ms_since_epoch() + slot_start(level) * _tick_us);
+}
+
+void TimingWheel::take_due(std::vector<Timer *> *expired) {
+  while (Timer *timer = _slots[ kDueSlot ]) {
+    unlink(timer);
+    --_size;
+    expired->push_back(timer);
+  }
+}
+
+// 每次直接跳到最早的非空槽的起点，不逐个tick前进，空闲很久之后调用也只和非空槽的个数有关
+// 最低的非空层的槽起点一定不是更高层的槽起点(本层槽号不为0)，所以每次只需要处理一个槽
+void TimingWheel::advance(Timestamp now, std::vector<Timer *> *expired) {
+  uint64_t target = _origin < now ? (now.ms_since_epoch() - _origin.ms_since_epoch()) / _tick_us : 0;
+  take_due(expired);
+  while (_now_tick < target) {
+    int level = lowest_level();
+    if (level < 0) {
+      _now_tick = target;
+      break;
+    }
+    uint64_t start = slot_start(level);
+    if (start > target) {
+      _now_tick = target;
+      break;
+    }
+    _now_tick = start;
+    int    slot = level * kSlotsPerLevel + static_cast<int>((start >> (level * kSlotBits)) & (kSlotsPerLevel - 1));
+    Timer *head = _slots[ slot ];
+    _slots[ slot ] = nullptr;
+    _occupied[ level ] &= ~(1ULL << (slot % kSlotsPerLevel));
+    Timer *timer = head;
+    do {
+      Timer *next = timer->_next;
+      timer->_slot = -1;
+      if (level == 0) {
+        timer->_prev = timer->_next = nullptr;
+        --_size;
+        expired->push_back(timer);
+      } else {
+        // 下移到更低的层，到期tick正好是start的直接到期
+        place(timer);
+      }
+      timer = next;
+    } while (timer != head);
+    take_due(expired);
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "timestamp.h"
+
+namespace muduo {
+
+class Timer;
+
+// 分层时间轮，TimerQueue按到期时间组织定时器的另一种实现，见MUDUO_TIMER_QUEUE
+//
+// 时间按tick_us离散成tick，共kLevels层，每层64个槽，第l层的一个槽覆盖64^l个tick。
+// 定时器按到期tick和当前tick第一个不同的6位所在的层放入对应的槽，当前tick走到这个槽的起点时，
+// 把槽中的定时器重新放到更低的层，走到第0层的槽时到期。每个定时器最多被下移kLevels-1次。
+// 每层用一个64位的bitmap记录非空的槽，求下一个到期时间、跳过没有定时器的tick都只需要扫描各层的bitmap。
+// 链表节点就在Timer中，add/remove是O(1)的链表操作，不分配内存。
+//
+// 代价是精度：到期tick向上取整，定时器不会提前触发，但最多晚一个tick；同一个tick中到期的定时器按加入的顺序触发。
+// 有slack的定时器在[到期时间, deadline]内选一个低位0最多的tick，窗口重叠的定时器落到同一个tick上一起触发；
+// 低位全是0的tick在所在层的槽起点就直接到期，也省掉了逐层下移。
+// 只能在loop线程中使用。
+class TimingWheel {
+public:
+  TimingWheel(Timestamp origin, int64_t tick_us);
+  ~TimingWheel() = default;
+
+  TimingWheel(const TimingWheel &) = delete;
+  TimingWheel &operator=(const TimingWheel &) = delete;
+
+  // timer不能已经在时间轮中
+  void add(Timer *timer);
+  void remove(Timer *timer);
+  bool contains(const Timer *timer) const;
+  // 取出到now为止到期的定时器，追加到expired
+  void advance(Timestamp now, std::vector<Timer *> *expired);
+
+  // 最早的非空槽的起始时间，在这之前advance不会取出任何定时器；没有定时器时返回invalid
+  // 这个槽在高层时，到这个时间advance只是把槽中的定时器下移，之后再次调用得到更精确的值
+  Timestamp next_expiration() const;
+  size_t    size() const { return _size; }
+  bool      empty() const { return _size == 0; }
+  int64_t   tick_us() const { return _tick_us; }
+
+private:
+  static const int kSlotBits = 6;
+  static const int kSlotsPerLevel = 1 << kSlotBits;
+  static const int kLevels = 11;                        // 11 * 6 >= 64，覆盖所有的tick，不需要溢出链表
+  static const int kDueSlot = kLevels * kSlotsPerLevel; // 加入时已经到期的定时器
+  static const int kNumSlots = kDueSlot + 1;
+
+  uint64_t tick_of(Timestamp when) const;
+  uint64_t tick_of(const Timer *timer) const;
+  // 第level层最早的非空槽的起始tick，该层必须非空
+  uint64_t slot_start(int level) const;
+  int      lowest_level() const;
+  void     place(Timer *timer);
+  void     link(int slot, Timer *timer);
+  void     unlink(Timer *timer);
+  void     take_due(std::vector<Timer *> *expired);
+
+  const Timestamp _origin;
+  const int64_t   _tick_us;
+  uint64_t        _now_tick; // 已经处理到的tick
+  size_t          _size;
+  uint64_t        _occupied[ kLevels ];
+  Timer          *_slots[ kNumSlots ]; // 循环双向链表的头
+};
+
+} // namespace muduo
@@ -0,0 +1,80 @@
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "muduo/src/current_thread.h"
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_threadpool.h"
+
+using namespace muduo;
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  const int kThreads = 3;
+  const int kTasks = 1000;
+
+  EventLoop           loop;
+  EventLoopThreadPool pool(&loop, "batch");
+  pool.set_thread_num(kThreads);
+  pool.start();
+
+  // 一批任务只入队一次，最多唤醒一次，并且按顺序执行
+  EventLoop              *target = pool.get_next_loop();
+  std::vector<int>        order;
+  std::atomic<bool>       done{false};
+  EventLoop::FunctorBatch batch;
+  for (int i = 0; i < kTasks; ++i) {
+    batch.push_back([ &order, i ] { order.push_back(i); });
+  }
+  batch.push_back([ &done ] { done = true; });
+  int64_t wakeups_before = target->wakeup_count();
+  target->queue_batch_in_loop(std::move(batch));
+  while (!done) {
+    ::usleep(1000);
+  }
+  assert(target->wakeup_count() - wakeups_before <= 1);
+  assert(static_cast<int>(order.size()) == kTasks);
+  for (int i = 0; i < kTasks; ++i) {
+    assert(order[ i ] == i);
+  }
+
+  // 在每个loop中执行一次，并收集结果
+  auto tids = pool.gather([](EventLoop *l) {
+    l->assert_in_loop_thread();
+    return tid();
+  });
+  assert(static_cast<int>(tids.size()) == kThreads);
+  for (int i = 0; i < kThreads; ++i) {
+    assert(tids[ i ] != tid());
+    LOG(INFO) << "gather: loop[" << i << "], tid[" << tids[ i ] << "]";
+  }
+
+  // 某个loop中f抛出异常，gather等所有loop执行完之后在这里抛出，不会一直阻塞
+  std::atomic<int> called{0};
+  bool             thrown = false;
+  try {
+    pool.gather([ &called, target ](EventLoop *l) {
+      ++called;
+      if (l == target) throw std::runtime_error("gather");
+      return 0;
+    });
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  assert(thrown && called == kThreads);
+  assert(static_cast<int>(pool.gather([](EventLoop *) { return 1; }).size()) == kThreads);
+
+  std::atomic<int> visited{0};
+  pool.broadcast([ &visited ](EventLoop *l) {
+    l->assert_in_loop_thread();
+    ++visited;
+  });
+  while (visited != kThreads) {
+    ::usleep(1000);
+  }
+  LOG(INFO) << "batch tasks[" << kTasks << "], wakeups[" << target->wakeup_count() - wakeups_before << "]";
+}
@@ -0,0 +1,89 @@
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "muduo/src/chunk_pool.h"
+#include "muduo/src/payload.h"
+#include "muduo/test/test_util.h"
+
+using namespace muduo;
+using namespace muduo::test;
+
+namespace {
+
+const int    kConns = 100;
+const size_t kLargeSize = 256 * 1024;
+
+// 所有连接建立之后从客户端线程broadcast一个小消息和两个大消息，每个连接都按顺序收到完整的数据，
+// 发送完之后payload被释放，大消息不拷贝到各个连接的输出缓冲区
+void check_broadcast(const char *poller, bool completion_mode, uint16_t port) {
+  ServerFixture                        fixture(poller, port, "broadcast");
+  TcpServer                           &server = fixture.server();
+  std::atomic<int>                     connected{0};
+  std::atomic<int>                     down{0};
+  std::mutex                           mutex;
+  std::set<std::shared_ptr<ChunkPool>> pools;
+  server.set_thread_num(2);
+  server.set_completion_mode(completion_mode);
+  server.set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+    if (conn->connected()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pools.insert(conn->get_loop()->chunk_pool());
+      }
+      ++connected;
+    } else {
+      ++down;
+    }
+  });
+
+  fixture.run([ & ] {
+    std::vector<int> fds;
+    for (int i = 0; i < kConns; ++i) fds.push_back(connect_to(port));
+    while (connected < kConns) ::usleep(1000);
+
+    std::string                                   expected;
+    std::vector<std::weak_ptr<const std::string>> weaks;
+    for (size_t size : {size_t(100), kLargeSize, kLargeSize}) {
+      Payload payload(make_message(size, static_cast<int>(weaks.size())));
+      expected.append(payload.view());
+      weaks.push_back(payload.owner());
+      server.broadcast(payload);
+    }
+    for (int sockfd : fds) {
+      std::string received = read_exactly(sockfd, expected.size());
+      assert(received == expected);
+    }
+    // 最后一次writev返回(或者send完成)之后才释放
+    for (int i = 0; i < 100 && !(weaks[ 1 ].expired() && weaks[ 2 ].expired()); ++i) ::usleep(10 * 1000);
+    for (auto &weak : weaks) assert(weak.expired());
+
+    int64_t peak = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const auto &pool : pools) peak += pool->stats().peak_borrowed_bytes;
+    }
+    LOG(INFO) << "poller[" << poller << "], completion_mode[" << completion_mode << "], conns[" << kConns
+              << "], broadcast bytes[" << expected.size() << "], peak borrowed chunk bytes[" << peak << "]";
+    // 拷贝的话需要kConns * 2 * kLargeSize，不拷贝时只有小消息(和slice写剩下的小尾巴)各占一个chunk
+    assert(peak <= static_cast<int64_t>(kConns * ChunkPool::kChunkSize));
+
+    for (int sockfd : fds) ::close(sockfd);
+    while (down < kConns) ::usleep(1000);
+  });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_broadcast("epoll", false, 19991);
+  check_broadcast("io_uring", false, 19992);
+  check_broadcast("io_uring", true, 19993);
+}
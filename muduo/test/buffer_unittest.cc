@@ -0,0 +1,191 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "muduo/src/buffer.h"
+#include "muduo/src/byte_search.h"
+
+using namespace muduo;
+
+namespace {
+
+void check_append_retrieve() {
+  Buffer buf;
+  assert(buf.readable_bytes() == 0);
+  assert(buf.writable_bytes() == Buffer::kInitialSize);
+  const std::string str(200, 'x');
+  buf.append(str);
+  assert(buf.readable_bytes() == str.size());
+  assert(buf.writable_bytes() == Buffer::kInitialSize - str.size());
+
+  std::string str2 = buf.retrieve_as_string(50);
+  assert(str2 == std::string(50, 'x'));
+  assert(buf.readable_bytes() == str.size() - 50);
+  assert(buf.prependable_bytes() == Buffer::kCheapPrepend + 50);
+
+  buf.retrieve_all();
+  assert(buf.readable_bytes() == 0);
+  assert(buf.prependable_bytes() == Buffer::kCheapPrepend);
+}
+
+// 前面读走的空间足够时挪动数据，不扩容
+void check_compaction() {
+  Buffer buf;
+  buf.append(std::string(800, 'y'));
+  buf.retrieve(500);
+  const size_t capacity = buf.internal_capacity();
+  const char  *base = buf.peek() - buf.prependable_bytes();
+  buf.append(std::string(400, 'z'));
+  assert(buf.internal_capacity() == capacity);
+  assert(buf.peek() - buf.prependable_bytes() == base);
+  assert(buf.prependable_bytes() == Buffer::kCheapPrepend);
+  assert(buf.readable_bytes() == 700);
+  assert(buf.retrieve_as_string(300) == std::string(300, 'y'));
+  assert(buf.retrieve_all_as_string() == std::string(400, 'z'));
+
+  // 不够时按倍数扩容
+  buf.append(std::string(2000, 'w'));
+  assert(buf.readable_bytes() == 2000);
+  assert(buf.internal_capacity() >= Buffer::kCheapPrepend + 2000);
+  buf.shrink(0);
+  assert(buf.internal_capacity() == Buffer::kCheapPrepend + 2000);
+  assert(buf.retrieve_all_as_string() == std::string(2000, 'w'));
+}
+
+void check_ints() {
+  Buffer buf;
+  buf.append("HTTP");
+  buf.append_int64(-0x0102030405060708LL);
+  buf.append_int32(0x01020304);
+  buf.append_int16(-2);
+  buf.append_int8(7);
+  buf.prepend_int32(static_cast<int32_t>(buf.readable_bytes()));
+  assert(buf.read_int32() == 4 + 8 + 4 + 2 + 1);
+  assert(buf.retrieve_as_string(4) == "HTTP");
+  assert(buf.read_int64() == -0x0102030405060708LL);
+  assert(buf.peek_int32() == 0x01020304);
+  assert(static_cast<unsigned char>(*buf.peek()) == 0x01); // 网络字节序
+  buf.retrieve_int32();
+  assert(buf.read_int16() == -2);
+  assert(buf.read_int8() == 7);
+  assert(buf.readable_bytes() == 0);
+  buf.append("abc");
+  buf.unwrite(1);
+  assert(buf.retrieve_all_as_string() == "ab");
+}
+
+void check_find() {
+  Buffer buf;
+  buf.append("GET / HTTP/1.1\r\nHost: x\r\n\r\n");
+  const char *crlf = buf.find_crlf();
+  assert(crlf == buf.peek() + 14);
+  assert(buf.find_crlf(crlf + 2) == buf.peek() + 23);
+  assert(buf.find_eol() == buf.peek() + 15);
+  buf.retrieve_until(crlf + 2);
+  assert(buf.to_string_view() == "Host: x\r\n\r\n");
+  buf.retrieve_all();
+  buf.append("no line end");
+  assert(buf.find_crlf() == nullptr);
+  assert(buf.find_eol() == nullptr);
+  assert(buf.find_byte('e') == buf.peek() + 6);
+  assert(buf.find_byte('z') == nullptr);
+}
+
+// 一行分多次到达，每次从上次停下的地方继续，"\r"和"\n"分在两次
+void check_find_resume() {
+  Buffer      buf;
+  std::string line = std::string(100, 'a') + "\r";
+  buf.append(line);
+  assert(buf.find_crlf() == nullptr);
+  buf.append(std::string(50, 'b'));
+  assert(buf.find_crlf() == nullptr);
+  assert(buf.find_eol() == nullptr);
+  buf.unwrite(50);
+  buf.append("\nnext");
+  assert(buf.find_crlf() == buf.peek() + 100);
+  assert(buf.find_eol() == buf.peek() + 101);
+  buf.retrieve(102);
+  assert(buf.find_crlf() == nullptr);
+  buf.append("\r\n");
+  assert(buf.find_crlf() == buf.peek() + 4);
+  // 挪动数据或者扩容之后仍然正确
+  buf.retrieve_all();
+  buf.append(std::string(900, 'c'));
+  assert(buf.find_eol() == nullptr);
+  buf.retrieve(800);
+  buf.append(std::string(5000, 'd') + "\n");
+  assert(buf.find_eol() == buf.peek() + 5100);
+  // prepend之后从头开始
+  buf.retrieve_all();
+  buf.append("abc");
+  assert(buf.find_eol() == nullptr);
+  buf.prepend("\n", 1);
+  assert(buf.find_eol() == buf.peek());
+}
+
+// 各个级别的实现和逐字节查找的结果一致，覆盖各种起点、长度和分隔符的位置
+void check_kernels() {
+  std::string data(300, 'x');
+  for (int level = byte_search::kScalar; level <= byte_search::kAvx2; ++level) {
+    const byte_search::Kernels *kernels = byte_search::kernels(static_cast<byte_search::Level>(level));
+    if (!kernels) continue;
+    srand(level);
+    for (int round = 0; round < 20000; ++round) {
+      std::fill(data.begin(), data.end(), 'x');
+      for (int i = rand() % 4; i > 0; --i) data[ rand() % data.size() ] = "\r\n"[ rand() % 2 ];
+      if (rand() % 2) data.replace(rand() % (data.size() - 1), 2, "\r\n");
+      const char *begin = data.data() + rand() % 40;
+      const char *end = begin + rand() % (data.data() + data.size() - begin + 1);
+      const char *lf = std::find(begin, end, '\n');
+      const char *crlf = std::search(begin, end, "\r\n", "\r\n" + 2);
+      assert(kernels->find_byte(begin, end, '\n') == (lf == end ? nullptr : lf));
+      assert(kernels->find_crlf(begin, end) == (crlf == end ? nullptr : crlf));
+      (void)lf;
+      (void)crlf;
+    }
+  }
+}
+
+// 可写空间放不下的数据读到extrabuf中，一次readv读完
+void check_read_fd() {
+  int fds[ 2 ];
+  int ret = ::pipe2(fds, O_NONBLOCK);
+  assert(ret == 0);
+  (void)ret;
+  std::string message(40000, '\0');
+  for (size_t i = 0; i < message.size(); ++i) message[ i ] = static_cast<char>('a' + i % 26);
+  ssize_t n = ::write(fds[ 1 ], message.data(), message.size());
+  assert(n == static_cast<ssize_t>(message.size()));
+
+  Buffer buf;
+  int    saved_errno = 0;
+  n = buf.read_fd(fds[ 0 ], &saved_errno);
+  assert(n == static_cast<ssize_t>(message.size()));
+  assert(buf.to_string_view() == message);
+
+  n = buf.read_fd(fds[ 0 ], &saved_errno);
+  assert(n < 0 && saved_errno == EAGAIN);
+  assert(buf.readable_bytes() == message.size());
+
+  ::close(fds[ 1 ]);
+  n = buf.read_fd(fds[ 0 ], &saved_errno);
+  assert(n == 0);
+  ::close(fds[ 0 ]);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_append_retrieve();
+  check_compaction();
+  check_ints();
+  check_find();
+  check_find_resume();
+  check_kernels();
+  check_read_fd();
+}
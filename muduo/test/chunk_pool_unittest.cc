@@ -0,0 +1,212 @@
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "muduo/src/buffer.h"
+#include "muduo/src/chunk_pool.h"
+#include "muduo/src/output_chain.h"
+#include "muduo/test/test_util.h"
+
+using namespace muduo;
+using namespace muduo::test;
+
+namespace {
+
+const int64_t kChunk = static_cast<int64_t>(ChunkPool::kChunkSize);
+
+// 借出、归还、缓存上限和peak
+void check_pool() {
+  ChunkPool pool;
+  pool.set_max_pooled_bytes(2 * kChunk);
+  std::vector<char *> chunks;
+  for (int i = 0; i < 4; ++i) chunks.push_back(pool.allocate());
+  ChunkPool::Stats stats = pool.stats();
+  assert(stats.borrowed_bytes == 4 * kChunk && stats.peak_borrowed_bytes == 4 * kChunk);
+  assert(stats.pooled_bytes == 0);
+  for (char *chunk : chunks) pool.deallocate(chunk);
+  stats = pool.stats();
+  assert(stats.borrowed_bytes == 0 && stats.peak_borrowed_bytes == 4 * kChunk);
+  assert(stats.pooled_bytes == 2 * kChunk);
+  // 复用缓存的chunk，不增加总量
+  int64_t total = ChunkPool::total_bytes();
+  char   *chunk = pool.allocate();
+  assert(ChunkPool::total_bytes() == total);
+  assert(pool.stats().pooled_bytes == kChunk);
+  pool.deallocate(chunk);
+  pool.trim();
+  assert(pool.stats().pooled_bytes == 0);
+  assert(ChunkPool::total_bytes() == total - 2 * kChunk);
+  (void)total;
+  (void)stats;
+}
+
+// 超过全局上限之后借用仍然成功，归还时不再缓存
+void check_memory_limit() {
+  ChunkPool pool;
+  ChunkPool::set_memory_limit(ChunkPool::total_bytes() + 2 * kChunk);
+  std::vector<char *> chunks;
+  for (int i = 0; i < 4; ++i) chunks.push_back(pool.allocate());
+  assert(pool.stats().over_limit_allocations == 2);
+  for (char *chunk : chunks) pool.deallocate(chunk);
+  assert(pool.stats().pooled_bytes <= 2 * kChunk);
+  ChunkPool::set_memory_limit(0);
+  pool.trim();
+}
+
+// 在其他线程中归还的chunk直接释放
+void check_other_thread() {
+  ChunkPool pool;
+  char     *chunk = pool.allocate();
+  std::thread([ & ] { pool.deallocate(chunk); }).join();
+  assert(pool.stats().borrowed_bytes == 0);
+  assert(pool.stats().pooled_bytes == 0);
+}
+
+void check_buffer() {
+  ChunkPool pool;
+  Buffer    buf(0);
+  assert(!buf.has_storage() && buf.readable_bytes() == 0);
+  buf.borrow_from(&pool);
+  assert(buf.has_storage() && pool.stats().borrowed_bytes == kChunk);
+  buf.append(std::string(100, 'a'));
+  assert(buf.retrieve_all_as_string() == std::string(100, 'a'));
+  buf.release_storage();
+  assert(!buf.has_storage() && pool.stats().borrowed_bytes == 0);
+
+  // 超过chunk大小之后换成从pool分配的更大的存储，chunk立即还回去，新的存储计入借出的字节数和总量
+  buf.borrow_from(&pool);
+  std::string big(ChunkPool::kChunkSize * 2, 'b');
+  int64_t     total = ChunkPool::total_bytes();
+  buf.append(big);
+  assert(pool.stats().borrowed_bytes == static_cast<int64_t>(buf.internal_capacity()));
+  assert(pool.stats().pooled_bytes == kChunk);
+  assert(ChunkPool::total_bytes() == total + static_cast<int64_t>(buf.internal_capacity()));
+  assert(buf.retrieve_all_as_string() == big);
+  buf.release_storage();
+  assert(pool.stats().borrowed_bytes == 0);
+  assert(ChunkPool::total_bytes() == total);
+  (void)total;
+
+  OutputChain chain(&pool);
+  chain.append(big);
+  assert(pool.stats().borrowed_bytes == 2 * kChunk);
+  chain.retrieve_all();
+  assert(pool.stats().borrowed_bytes == 0);
+}
+
+const int    kConns = 64;
+const size_t kMessageSize = 40000;
+
+// 每个连接echo一条消息之后保持空闲，之后所有连接都不应该再占用chunk
+// (边沿触发时每次事件最后都读到EAGAIN，读之前借的chunk也要还回去)
+void check_server(const char *poller, bool completion_mode, bool edge_triggered, uint16_t port) {
+  ServerFixture            fixture(poller, port, "pool");
+  TcpServer               &server = fixture.server();
+  std::atomic<EventLoop *> io_loop{nullptr};
+  server.set_thread_num(1);
+  server.set_completion_mode(completion_mode);
+  server.set_edge_triggered(edge_triggered);
+  server.set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+    assert(conn->edge_triggered() == edge_triggered);
+    io_loop = conn->get_loop();
+  });
+  server.set_message_callback(
+    [](const std::shared_ptr<TcpConnection> &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+
+  fixture.run([ & ] {
+    std::string      message = make_message(kMessageSize, 0);
+    std::vector<int> fds;
+    for (int i = 0; i < kConns; ++i) {
+      int sockfd = connect_to(port);
+      write_all(sockfd, message);
+      std::string received = read_exactly(sockfd, message.size());
+      assert(received == message);
+      fds.push_back(sockfd);
+    }
+    // 最后一次writev返回之后才归还，等一会儿
+    std::shared_ptr<ChunkPool> pool = io_loop.load()->chunk_pool();
+    for (int i = 0; i < 100 && pool->stats().borrowed_bytes != 0; ++i) ::usleep(10 * 1000);
+    ChunkPool::Stats stats = pool->stats();
+    LOG(INFO) << "poller[" << poller << "], completion_mode[" << completion_mode << "], edge_triggered["
+              << edge_triggered << "], idle conns[" << kConns
+              << "], borrowed[" << stats.borrowed_bytes << "], pooled[" << stats.pooled_bytes << "], peak["
+              << stats.peak_borrowed_bytes << "]";
+    assert(stats.borrowed_bytes == 0);
+    assert(stats.peak_borrowed_bytes > 0);
+    for (int sockfd : fds) ::close(sockfd);
+  });
+}
+
+const size_t  kPausedBytes = 16 * 1024 * 1024;
+const int64_t kLimitBytes = 256 * 1024;
+
+// 服务端一直不处理输入，直到收齐kPausedBytes。缓冲区总量超过上限之后暂停读，输入不再增长；
+// 去掉上限之后恢复读，数据一个字节也不少。
+// 就绪模式下暂停之前最后一次read_fd最多多读64KiB；完成模式下取消recv之前内核已经收进provided buffer的
+// 数据(最多整个buffer组，4MB)仍然要处理，所以只检查没有全部读进来
+void check_backpressure(const char *poller, bool completion_mode, uint16_t port) {
+  ServerFixture       fixture(poller, port, "backpressure");
+  TcpServer          &server = fixture.server();
+  std::atomic<size_t> readable{0};
+  std::atomic<size_t> peak{0};
+  std::atomic<bool>   received{false};
+  server.set_completion_mode(completion_mode);
+  server.set_message_callback([ & ](const std::shared_ptr<TcpConnection> &, Buffer *buf, Timestamp) {
+    readable = buf->readable_bytes();
+    if (readable > peak) peak = readable.load();
+    if (buf->readable_bytes() == kPausedBytes) {
+      buf->retrieve_all();
+      received = true;
+    }
+  });
+  const int64_t base = ChunkPool::total_bytes();
+  ChunkPool::set_memory_limit(base + kLimitBytes);
+
+  fixture.run([ & ] {
+    int         sockfd = connect_to(port);
+    std::thread writer([ sockfd ] { write_all(sockfd, std::string(kPausedBytes, 'p')); });
+    // 等输入停止增长
+    size_t last = 0;
+    for (int i = 0; i < 100; ++i) {
+      ::usleep(50 * 1000);
+      if (readable > 0 && readable == last) break;
+      last = readable;
+    }
+    size_t paused_at = readable;
+    LOG(INFO) << "poller[" << poller << "], completion_mode[" << completion_mode << "], paused at[" << paused_at
+              << "], total over base[" << ChunkPool::total_bytes() - base << "]";
+    assert(paused_at > 0 && paused_at < kPausedBytes);
+    assert(completion_mode || paused_at <= static_cast<size_t>(kLimitBytes) + 65536);
+    assert(!received);
+    (void)paused_at;
+
+    ChunkPool::set_memory_limit(0);
+    for (int i = 0; i < 500 && !received; ++i) ::usleep(10 * 1000);
+    assert(received);
+    writer.join();
+    ::close(sockfd);
+  });
+  LOG(INFO) << "peak input before resume[" << peak << "]";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_pool();
+  check_memory_limit();
+  check_other_thread();
+  check_buffer();
+  check_server("epoll", false, false, 19981);
+  check_server("io_uring", false, false, 19982);
+  check_server("io_uring", true, false, 19983);
+  check_server("epoll", false, true, 19984);
+  check_backpressure("epoll", false, 19985);
+  check_backpressure("io_uring", false, 19986);
+  check_backpressure("io_uring", true, 19987);
+}
@@ -0,0 +1,83 @@
+#include <glog/logging.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "muduo/src/channel.h"
+#include "muduo/src/event_loop.h"
+
+using namespace muduo;
+
+// 一轮中对同一个fd的多次修改合并成一次epoll_ctl，抵消掉的修改不提交，remove之后fd可以马上被复用
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  EventLoop loop(PollerBackend::kEpoll);
+  assert(std::string(loop.poller_name()) == "epoll");
+
+  int                      fd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+  std::unique_ptr<Channel> ch(new Channel(&loop, fd));
+  int                      reads = 0;
+  int                      writes = 0;
+  ch->set_read_callback([ & ](Timestamp) {
+    uint64_t value;
+    ssize_t  n = ::read(fd, &value, sizeof value);
+    (void)n;
+    ++reads;
+  });
+  ch->set_write_callback([ & ] { ++writes; });
+
+  int64_t syscalls = 0;
+  int64_t elided = 0;
+  auto    snapshot = [ & ] {
+    syscalls = loop.poller_syscalls();
+    elided = loop.poller_elided_updates();
+  };
+
+  // 每一步在pending functors中执行，下一步之前正好经过一次epoll_wait
+  loop.queue_in_loop([ & ] {
+    snapshot();
+    // 三次修改，最终只关注可读：一次EPOLL_CTL_ADD
+    ch->enable_reading();
+    ch->enable_writing();
+    ch->disable_writing();
+    loop.queue_in_loop([ & ] {
+      assert(loop.poller_syscalls() - syscalls == 2); // ADD + epoll_wait
+      assert(loop.poller_elided_updates() - elided == 2);
+      assert(reads == 1 && writes == 0);
+      snapshot();
+      // 相互抵消，不需要epoll_ctl
+      ch->enable_writing();
+      ch->disable_writing();
+      loop.queue_in_loop([ & ] {
+        assert(loop.poller_syscalls() - syscalls == 1); // epoll_wait
+        assert(loop.poller_elided_updates() - elided == 2);
+        assert(writes == 0);
+        // remove立即生效，同一轮中fd被新的Channel复用
+        ch->disable_all();
+        ch->remove();
+        ::close(fd);
+        fd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+        int old_reads = reads;
+        ch.reset(new Channel(&loop, fd));
+        ch->set_read_callback([ &, old_reads ](Timestamp) {
+          uint64_t value;
+          ssize_t  n = ::read(fd, &value, sizeof value);
+          (void)n;
+          LOG(INFO) << "new channel on fd=" << fd << " readable";
+          assert(reads == old_reads);
+          ch->disable_all();
+          ch->remove();
+          loop.quit();
+        });
+        ch->enable_reading();
+      });
+    });
+  });
+  loop.loop();
+  ::close(fd);
+  LOG(INFO) << "elided epoll_ctl=" << loop.poller_elided_updates() << ", poller syscalls=" << loop.poller_syscalls();
+}
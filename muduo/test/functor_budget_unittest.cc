@@ -0,0 +1,51 @@
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <vector>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_thread.h"
+
+using namespace muduo;
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  const int kTasks = 10000;
+  const int kBudget = 100;
+
+  EventLoopThread loop_thread(EventLoopThread::ThreadInitCallback(), "functor_budget");
+  auto           *loop = loop_thread.start_loop();
+  loop->set_functor_budget(kBudget, 0);
+
+  // 在loop线程中一次性提交，保证所有任务在同一轮之前入队
+  std::vector<int>  order;
+  std::atomic<bool> submitted{false};
+  int64_t           start_iteration = 0;
+  loop->run_in_loop([ & ] {
+    start_iteration = loop->iteration();
+    for (int i = 0; i < kTasks; ++i) {
+      loop->queue_in_loop([ &order, i ] { order.push_back(i); });
+    }
+    submitted = true;
+  });
+  while (!submitted) {
+    ::usleep(1000);
+  }
+
+  std::atomic<bool> done{false};
+  loop->queue_in_loop([ &done ] { done = true; });
+  while (!done) {
+    ::usleep(1000);
+  }
+
+  // 超出预算的留到下一轮，顺序不变
+  assert(static_cast<int>(order.size()) == kTasks);
+  for (int i = 0; i < kTasks; ++i) {
+    assert(order[ i ] == i);
+  }
+  int64_t iterations = loop->iteration() - start_iteration;
+  LOG(INFO) << "tasks[" << kTasks << "], budget[" << kBudget << "], iterations[" << iterations << "]";
+  assert(iterations >= kTasks / kBudget);
+}
@@ -0,0 +1,91 @@
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "muduo/test/test_util.h"
+
+using namespace muduo;
+using namespace muduo::test;
+
+namespace {
+
+const int    kIdleConns = 50;
+const int    kActiveConns = 4;
+const int    kTimeoutSeconds = 1;
+const double kActiveSeconds = 3.0;
+
+// 不发送数据，等服务端关闭，返回从连接到被关闭的秒数
+double idle_client(uint16_t port) {
+  Timestamp start = Timestamp::now();
+  int       sockfd = connect_to(port);
+  char      buf[ 16 ];
+  ssize_t   n = ::read(sockfd, buf, sizeof buf);
+  assert(n == 0);
+  (void)n;
+  ::close(sockfd);
+  return (Timestamp::now() - start) / 1e6;
+}
+
+// 每200ms发送一次，持续的时间超过timeout，连接不应该被关闭
+void active_client(uint16_t port) {
+  Timestamp start = Timestamp::now();
+  int       sockfd = connect_to(port);
+  while ((Timestamp::now() - start) / 1e6 < kActiveSeconds) {
+    ssize_t n = ::write(sockfd, "x", 1);
+    assert(n == 1);
+    char buf[ 16 ];
+    n = ::read(sockfd, buf, sizeof buf);
+    assert(n == 1);
+    (void)n;
+    ::usleep(200 * 1000);
+  }
+  ::close(sockfd);
+}
+
+void run(int num_threads, uint16_t port) {
+  ServerFixture    fixture(nullptr, port, "idle");
+  TcpServer       &server = fixture.server();
+  std::atomic<int> down{0};
+  server.set_thread_num(num_threads);
+  server.set_idle_timeout(kTimeoutSeconds);
+  server.set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+    if (!conn->connected()) ++down;
+  });
+  server.set_message_callback(
+    [](const std::shared_ptr<TcpConnection> &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+
+  std::vector<double> idle_seconds(kIdleConns);
+  fixture.run([ & ] {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kActiveConns; ++i) threads.emplace_back(active_client, port);
+    for (int i = 0; i < kIdleConns; ++i) {
+      threads.emplace_back([ &, i ] { idle_seconds[ i ] = idle_client(port); });
+    }
+    for (auto &t : threads) t.join();
+    while (down != kIdleConns + kActiveConns) ::usleep(1000);
+  });
+
+  double min_idle = kTimeoutSeconds * 10.0;
+  double max_idle = 0.0;
+  for (double s : idle_seconds) {
+    min_idle = std::min(min_idle, s);
+    max_idle = std::max(max_idle, s);
+  }
+  LOG(INFO) << "threads[" << num_threads << "], idle conns closed after [" << min_idle << ", " << max_idle
+            << "] seconds";
+  // 至少空闲了timeout，最多晚一个桶再加上定时器的slack
+  assert(min_idle > kTimeoutSeconds - 0.05);
+  assert(max_idle < kTimeoutSeconds + 1.5);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  run(0, 19991);
+  run(2, 19992);
+}
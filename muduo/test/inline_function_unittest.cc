@@ -0,0 +1,144 @@
+#include "muduo/src/inline_function.h"
+
+#include <glog/logging.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <typeinfo>
+
+using namespace muduo;
+
+namespace {
+
+using Function = InlineFunction<int(int)>;
+
+// 统计构造和析构的次数，检查每个对象都只析构一次
+struct Counted {
+  static int alive;
+  static int destroyed;
+
+  explicit Counted(int v)
+      : value(v) {
+    ++alive;
+  }
+  Counted(const Counted &rhs)
+      : value(rhs.value) {
+    ++alive;
+  }
+  Counted(Counted &&rhs) noexcept
+      : value(rhs.value) {
+    ++alive;
+  }
+  ~Counted() {
+    --alive;
+    ++destroyed;
+  }
+
+  int value;
+};
+int Counted::alive = 0;
+int Counted::destroyed = 0;
+
+// 小的lambda内联存放，大的退回到堆上
+void check_inline_and_heap() {
+  int      base = 10;
+  Function small([ base ](int x) { return base + x; });
+  assert(small && small.is_inline());
+  assert(small(5) == 15);
+
+  std::array<char, Function::kInlineSize + 1> big{};
+  big[ 0 ] = 3;
+  Function large([ big ](int x) { return big[ 0 ] * x; });
+  assert(large && !large.is_inline());
+  assert(large(4) == 12);
+
+  // 移动不可抛异常的类型才能内联，否则移动InlineFunction时无法保证noexcept
+  struct ThrowingMove {
+    ThrowingMove() = default;
+    ThrowingMove(ThrowingMove &&) noexcept(false) {}
+    int operator()(int x) const { return x; }
+  };
+  Function throwing{ThrowingMove()};
+  assert(!throwing.is_inline() && throwing(7) == 7);
+
+  Function empty;
+  assert(!empty && !empty.is_inline());
+  assert(empty.target_type() == typeid(void));
+  // 空的函数指针和std::function得到空的InlineFunction
+  int (*null_fp)(int) = nullptr;
+  assert(!Function(null_fp));
+  assert(!Function(std::function<int(int)>()));
+  assert(Function(std::function<int(int)>([](int x) { return x; }))(1) == 1);
+
+  int (*fp)(int) = [](int x) { return -x; };
+  Function from_fp(fp);
+  assert(from_fp.is_inline() && from_fp(3) == -3);
+  assert(from_fp.target_type() == typeid(int (*)(int)));
+}
+
+// 只能移动的捕获，移动之后源对象为空，所有权跟着走
+void check_move_only() {
+  auto     owned = std::make_unique<int>(42);
+  Function f([ p = std::move(owned) ](int x) { return *p + x; });
+  assert(f.is_inline() && f(0) == 42);
+
+  Function g(std::move(f));
+  assert(!f && g);
+  assert(g(1) == 43);
+  assert(g.target_type() != typeid(void));
+
+  Function h;
+  h = std::move(g);
+  assert(!g && h && h(2) == 44);
+
+  // 调用可以修改内部状态(和std::function一样operator()是const的)
+  Function counter([ n = 0 ](int x) mutable { return n += x; });
+  assert(counter(1) == 1 && counter(2) == 3);
+
+  h = nullptr;
+  assert(!h);
+}
+
+// 内联和堆上两种情况下，移动、赋值、重置和析构都不泄漏、不重复析构
+void check_destruction() {
+  Counted::destroyed = 0;
+  {
+    Function f([ c = Counted(1) ](int x) { return c.value + x; });
+    assert(f.is_inline() && Counted::alive == 1);
+    Function g(std::move(f));
+    assert(Counted::alive == 1);
+    assert(g(1) == 2);
+    Function h([ c = Counted(2) ](int x) { return c.value * x; });
+    assert(Counted::alive == 2);
+    // 赋值先析构自己原来的对象
+    h = std::move(g);
+    assert(Counted::alive == 1 && h(3) == 4);
+  }
+  assert(Counted::alive == 0);
+
+  {
+    std::array<char, Function::kInlineSize> padding{};
+    Function f([ c = Counted(5), padding ](int x) { return c.value + x + padding[ 0 ]; });
+    assert(!f.is_inline() && Counted::alive == 1);
+    int destroyed = Counted::destroyed;
+    // 堆上的对象移动时只转移指针，不构造新对象
+    Function g(std::move(f));
+    assert(Counted::alive == 1 && Counted::destroyed == destroyed);
+    assert(g(1) == 6);
+    g = nullptr;
+    assert(Counted::alive == 0 && Counted::destroyed == destroyed + 1);
+  }
+  assert(Counted::alive == 0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_inline_and_heap();
+  check_move_only();
+  check_destruction();
+  LOG(INFO) << "sizeof(InlineFunction<int(int)>) = " << sizeof(Function);
+}
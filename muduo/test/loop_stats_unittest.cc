@@ -0,0 +1,30 @@
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_thread.h"
+
+using namespace muduo;
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  EventLoopThread loop_thread(EventLoopThread::ThreadInitCallback(), "loop_stats");
+  auto           *loop = loop_thread.start_loop();
+  loop->enable_stats(true);
+
+  loop->run_every(0.01, [] { ::usleep(100); });
+  for (int i = 0; i < 1000; ++i) {
+    loop->queue_in_loop([] {});
+    if (i % 100 == 0) ::usleep(20 * 1000);
+  }
+  ::usleep(100 * 1000);
+
+  // 在其他线程读取统计快照
+  const auto &stats = loop->stats();
+  LOG(INFO) << "iteration[" << loop->iteration() << "], " << stats.to_string();
+  assert(loop->iteration() > 0);
+  assert(stats.poll_ns.snapshot().count > 0);
+  assert(stats.timers_ns.snapshot().count > 0);
+  assert(stats.functors_count.snapshot().sum > 0);
+}
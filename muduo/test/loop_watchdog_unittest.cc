@@ -0,0 +1,116 @@
+#include "muduo/src/loop_watchdog.h"
+
+#include <glog/logging.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <typeinfo>
+#include <vector>
+
+#include "muduo/src/channel.h"
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_thread.h"
+
+using namespace muduo;
+
+namespace {
+
+void slow_callback() {
+  LOG(INFO) << "slow_callback begin";
+  ::usleep(300 * 1000);
+  LOG(INFO) << "slow_callback end";
+}
+
+std::mutex                       g_mutex;
+std::vector<LoopWatchdog::Stall> g_stalls;
+
+// 等卡住的回调结束、watchdog报告完，取出这段时间报告的卡顿
+std::vector<LoopWatchdog::Stall> take_stalls() {
+  ::usleep(500 * 1000);
+  std::lock_guard<std::mutex> lock(g_mutex);
+  std::vector<LoopWatchdog::Stall> stalls;
+  stalls.swap(g_stalls);
+  return stalls;
+}
+
+// 每次卡顿只报告一次，报告的是卡住时loop正在执行的东西
+void check_watchdog(const char *timer_mode) {
+  ::setenv("MUDUO_TIMER", timer_mode, 1);
+  EventLoopThread loop_thread(EventLoopThread::ThreadInitCallback(), "watched_loop");
+  auto           *loop = loop_thread.start_loop();
+
+  // 超过100ms就报告，并抓取调用栈
+  LoopWatchdog watchdog(0.1, true);
+  watchdog.set_stall_callback([](const LoopWatchdog::Stall &stall) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_stalls.push_back(stall);
+  });
+  watchdog.watch(loop);
+  // 心跳从loop的下一轮开始发布，先让阻塞在poll中的loop转一轮
+  loop->queue_in_loop([] {});
+  ::usleep(10 * 1000);
+
+  // 卡在pending functor中
+  int64_t before = loop->iteration();
+  loop->queue_in_loop(slow_callback);
+  auto stalls = take_stalls();
+  assert(stalls.size() == 1);
+  assert(stalls[ 0 ].loop == loop);
+  assert(stalls[ 0 ].stalled_ns > 100 * 1000 * 1000);
+  assert(stalls[ 0 ].iteration >= before && stalls[ 0 ].iteration < loop->iteration());
+  assert(stalls[ 0 ].functor && *stalls[ 0 ].functor == typeid(void (*)()));
+  assert(stalls[ 0 ].fd == -1 && !stalls[ 0 ].timers);
+
+  // 卡在定时器回调中：timerfd模式下在timerfd的Channel中执行(fd也被设置)，poll超时模式下不在任何Channel中
+  loop->run_after(0.05, slow_callback);
+  stalls = take_stalls();
+  assert(stalls.size() == 1);
+  assert(stalls[ 0 ].timers && !stalls[ 0 ].functor);
+  assert(loop->uses_timerfd() ? stalls[ 0 ].fd >= 0 : stalls[ 0 ].fd == -1);
+
+  // 卡在Channel的读回调中
+  int pipefd[ 2 ];
+  int ret = ::pipe(pipefd);
+  assert(ret == 0);
+  (void)ret;
+  Channel channel(loop, pipefd[ 0 ]);
+  loop->run_in_loop([ & ] {
+    channel.set_read_callback([ & ](Timestamp) {
+      char c;
+      ssize_t n = ::read(pipefd[ 0 ], &c, 1);
+      (void)n;
+      slow_callback();
+    });
+    channel.enable_reading();
+  });
+  ssize_t n = ::write(pipefd[ 1 ], "x", 1);
+  (void)n;
+  stalls = take_stalls();
+  assert(stalls.size() == 1);
+  assert(stalls[ 0 ].fd == pipefd[ 0 ]);
+  assert(!stalls[ 0 ].functor && !stalls[ 0 ].timers);
+
+  // 没有卡顿时不报告
+  loop->queue_in_loop([] {});
+  assert(take_stalls().empty());
+
+  watchdog.unwatch(loop);
+  loop->run_in_loop([ & ] {
+    channel.disable_all();
+    channel.remove();
+  });
+  ::usleep(100 * 1000);
+  ::close(pipefd[ 0 ]);
+  ::close(pipefd[ 1 ]);
+  LOG(INFO) << "timer mode[" << timer_mode << "] ok";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_watchdog("timerfd");
+  check_watchdog("poll");
+}
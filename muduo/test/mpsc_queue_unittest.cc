@@ -0,0 +1,132 @@
+#include "muduo/src/mpsc_queue.h"
+
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace muduo;
+
+namespace {
+
+struct Item {
+  int producer;
+  int seq;        // 每个生产者从0开始连续编号
+  int batch_size; // push提交的为0
+  int batch_index;
+};
+
+const int kProducers = 4;
+const int kItems = 200000;
+const int kBatchSize = 7;
+
+// 每个生产者交替用push和push_batch提交，消费者检查：
+// 同一个生产者的元素按提交顺序出现，不丢不重；同一个push_batch的元素在同一批中连续出现
+void check_concurrent() {
+  MpscQueue<Item>          queue;
+  std::atomic<int>         finished{0};
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([ &queue, &finished, p ] {
+      int seq = 0;
+      while (seq < kItems) {
+        if (seq % 3 == 0 && seq + kBatchSize <= kItems) {
+          MpscQueue<Item>::Batch batch;
+          for (int i = 0; i < kBatchSize; ++i) batch.push_back(Item{p, seq++, kBatchSize, i});
+          queue.push_batch(std::move(batch));
+        } else {
+          queue.push(Item{p, seq++, 0, 0});
+        }
+      }
+      ++finished;
+    });
+  }
+
+  std::vector<int> next(kProducers, 0);
+  int64_t          total = 0;
+  int64_t          batches = 0;
+  while (true) {
+    // 先看生产者是否都结束了，再取，保证最后一次能取到所有剩下的元素
+    bool done = finished == kProducers;
+    auto batch = queue.take_all();
+    if (!batch.empty()) ++batches;
+    while (!batch.empty()) {
+      Item item = batch.front();
+      batch.pop_front();
+      assert(item.producer >= 0 && item.producer < kProducers);
+      assert(item.seq == next[ item.producer ]);
+      ++next[ item.producer ];
+      ++total;
+      if (item.batch_size > 0) {
+        assert(item.batch_index == 0);
+        for (int i = 1; i < item.batch_size; ++i) {
+          assert(!batch.empty());
+          Item member = batch.front();
+          batch.pop_front();
+          assert(member.producer == item.producer && member.batch_index == i);
+          assert(member.seq == next[ item.producer ]);
+          ++next[ item.producer ];
+          ++total;
+        }
+      }
+    }
+    if (done) break;
+  }
+  for (auto &t : producers) t.join();
+  assert(queue.empty());
+  for (int p = 0; p < kProducers; ++p) assert(next[ p ] == kItems);
+  assert(total == static_cast<int64_t>(kProducers) * kItems);
+  LOG(INFO) << "producers[" << kProducers << "], items[" << total << "], batches taken[" << batches << "]";
+  (void)total;
+}
+
+// push的返回值、Batch::append的顺序，只能移动的元素在队列和批次析构时被释放
+void check_single_thread() {
+  MpscQueue<std::unique_ptr<int>> queue;
+  assert(queue.empty());
+  assert(queue.push(std::make_unique<int>(0)));
+  assert(!queue.push(std::make_unique<int>(1)));
+  assert(!queue.push_batch(MpscQueue<std::unique_ptr<int>>::Batch()));
+
+  MpscQueue<std::unique_ptr<int>>::Batch more;
+  more.push_back(std::make_unique<int>(2));
+  more.push_back(std::make_unique<int>(3));
+  assert(more.size() == 2);
+  assert(!queue.push_batch(std::move(more)));
+  assert(more.empty());
+
+  auto batch = queue.take_all();
+  assert(queue.empty() && batch.size() == 4);
+  MpscQueue<std::unique_ptr<int>>::Batch tail;
+  tail.push_back(std::make_unique<int>(4));
+  batch.append(std::move(tail));
+  assert(tail.empty() && batch.size() == 5);
+  for (int i = 0; i < 5; ++i) {
+    assert(*batch.front() == i);
+    batch.pop_front();
+  }
+  assert(batch.empty());
+
+  std::weak_ptr<int> weak;
+  {
+    MpscQueue<std::shared_ptr<int>> pending;
+    auto                            value = std::make_shared<int>(42);
+    weak = value;
+    pending.push(std::move(value));
+    assert(!weak.expired());
+  }
+  // 没有被取走的元素随队列析构
+  assert(weak.expired());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_single_thread();
+  check_concurrent();
+}
@@ -0,0 +1,185 @@
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+#include "muduo/src/output_chain.h"
+#include "muduo/test/test_util.h"
+
+using namespace muduo;
+using namespace muduo::test;
+
+namespace {
+
+std::string drain(const OutputChain &chain) {
+  struct iovec iov[ 1024 ];
+  int          count = chain.fill_iovec(iov, 1024);
+  std::string  result;
+  for (int i = 0; i < count; ++i) result.append(static_cast<const char *>(iov[ i ].iov_base), iov[ i ].iov_len);
+  return result;
+}
+
+// 拷贝的数据跨chunk，slice不拷贝，发送完之后释放owner
+void check_chain() {
+  OutputChain chain;
+  std::string expected;
+  std::string small = make_message(100, 0);
+  std::string big = make_message(OutputChain::kChunkSize * 2 + 10, 1);
+  chain.append(small);
+  chain.append(big);
+  expected += small + big;
+  assert(chain.segments() == 3);
+
+  auto slice = std::make_shared<std::string>(make_message(5000, 2));
+  std::weak_ptr<std::string> weak = slice;
+  chain.append_slice(*slice, slice);
+  expected += *slice;
+  slice.reset();
+  assert(!weak.expired());
+  // 小的slice直接拷贝
+  std::string tiny = make_message(10, 3);
+  chain.append_slice(tiny, nullptr);
+  expected += tiny;
+  assert(chain.segments() == 5);
+  assert(chain.readable_bytes() == expected.size());
+  assert(drain(chain) == expected);
+
+  chain.retrieve(50);
+  expected.erase(0, 50);
+  assert(drain(chain) == expected);
+  // 发送完前两个chunk和slice
+  size_t before_tiny = expected.size() - tiny.size();
+  chain.retrieve(before_tiny);
+  expected.erase(0, before_tiny);
+  assert(weak.expired());
+  assert(drain(chain) == expected);
+  chain.retrieve(expected.size());
+  assert(chain.empty());
+  // 发送完的chunk全部归还
+  assert(chain.segments() == 0);
+  chain.append("abc", 3);
+  assert(chain.segments() == 1 && drain(chain) == "abc");
+}
+
+void check_write_fd() {
+  int fds[ 2 ];
+  int ret = ::pipe2(fds, O_NONBLOCK);
+  assert(ret == 0);
+  (void)ret;
+  OutputChain chain;
+  std::string expected = make_message(30000, 4);
+  chain.append(expected.data(), 10000);
+  auto slice = std::make_shared<std::string>(expected.substr(10000));
+  chain.append_slice(*slice, slice);
+  int     saved_errno = 0;
+  ssize_t n = chain.write_fd(fds[ 1 ], &saved_errno);
+  assert(n == static_cast<ssize_t>(expected.size()));
+  assert(chain.empty());
+  std::string received(expected.size(), '\0');
+  n = ::read(fds[ 0 ], &received[ 0 ], received.size());
+  assert(n == static_cast<ssize_t>(expected.size()));
+  assert(received == expected);
+  ::close(fds[ 0 ]);
+  ::close(fds[ 1 ]);
+}
+
+// segment多于kMaxIov时一次writev只提交前kMaxIov个，剩下的留给下一次
+void check_write_fd_max_iov() {
+  int fds[ 2 ];
+  int ret = ::pipe2(fds, O_NONBLOCK);
+  assert(ret == 0);
+  (void)ret;
+  const int   kSlices = OutputChain::kMaxIov + 36;
+  OutputChain chain;
+  std::string expected = make_message(kSlices * OutputChain::kMinSliceSize, 5);
+  auto        owner = std::make_shared<std::string>(expected);
+  for (int i = 0; i < kSlices; ++i) {
+    chain.append_slice(std::string_view(*owner).substr(i * OutputChain::kMinSliceSize, OutputChain::kMinSliceSize),
+                       owner);
+  }
+  assert(chain.segments() == static_cast<size_t>(kSlices));
+  std::string received;
+  char        buf[ 65536 ];
+  int         saved_errno = 0;
+  ssize_t     n = chain.write_fd(fds[ 1 ], &saved_errno);
+  assert(n == static_cast<ssize_t>(OutputChain::kMaxIov * OutputChain::kMinSliceSize));
+  assert(chain.segments() == static_cast<size_t>(kSlices - OutputChain::kMaxIov));
+  while (!chain.empty()) {
+    ssize_t r = ::read(fds[ 0 ], buf, sizeof buf);
+    assert(r > 0);
+    received.append(buf, r);
+    n = chain.write_fd(fds[ 1 ], &saved_errno);
+    assert(n > 0);
+  }
+  for (ssize_t r; (r = ::read(fds[ 0 ], buf, sizeof buf)) > 0;) received.append(buf, r);
+  assert(received == expected);
+  ::close(fds[ 0 ]);
+  ::close(fds[ 1 ]);
+}
+
+const size_t kSliceBytes = 4 * 1024 * 1024;
+
+// 连接建立后服务端混合发送小的拷贝数据和大的slice，客户端收完后比较内容，slice发送完之后被释放
+void check_server(const char *poller, bool completion_mode, bool edge_triggered, uint16_t port) {
+  ServerFixture fixture(poller, port, "chain");
+  TcpServer    &server = fixture.server();
+  auto          payload = std::make_shared<const std::string>(make_message(kSliceBytes, 5));
+  std::string expected;
+  for (int i = 0; i < 4; ++i) {
+    expected += make_message(100 + i, i);
+    expected += *payload;
+  }
+  std::weak_ptr<const std::string> weak = payload;
+  std::atomic<bool>                down{false};
+  server.set_thread_num(1);
+  server.set_completion_mode(completion_mode);
+  server.set_edge_triggered(edge_triggered);
+  server.set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+    if (conn->connected()) {
+      // 只有一个连接，之后只由输出缓冲区中的slice持有
+      auto slice = std::move(payload);
+      for (int i = 0; i < 4; ++i) {
+        conn->send(make_message(100 + i, i));
+        conn->send_slice(*slice, slice);
+      }
+      conn->shutdown();
+    } else {
+      down = true;
+    }
+  });
+
+  fixture.run([ & ] {
+    int         sockfd = connect_to(port);
+    std::string received;
+    char        buf[ 65536 ];
+    while (true) {
+      ssize_t n = ::read(sockfd, buf, sizeof buf);
+      assert(n >= 0);
+      if (n == 0) break;
+      received.append(buf, n);
+    }
+    assert(received == expected);
+    ::close(sockfd);
+    while (!down) ::usleep(1000);
+  });
+  LOG(INFO) << "poller[" << poller << "], completion_mode[" << completion_mode << "], edge_triggered["
+            << edge_triggered << "] ok";
+  assert(weak.expired());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_chain();
+  check_write_fd();
+  check_write_fd_max_iov();
+  check_server("epoll", false, false, 19971);
+  check_server("epoll", false, true, 19972);
+  check_server("io_uring", false, false, 19973);
+  check_server("io_uring", true, false, 19974);
+}
@@ -0,0 +1,132 @@
+#include <glog/logging.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "muduo/test/test_util.h"
+
+using namespace muduo;
+using namespace muduo::test;
+
+namespace {
+
+const int    kConns = 10;
+const size_t kBytes = 256 * 1024;
+
+// 阻塞的客户端：发送kBytes字节，读回同样的内容
+void echo_client(uint16_t port, int id) {
+  int         sockfd = connect_to(port);
+  std::string message = make_message(kBytes, id);
+  std::thread writer([ sockfd, &message ] { write_all(sockfd, message, 8192); });
+  std::string received = read_exactly(sockfd, kBytes);
+  writer.join();
+  assert(received == message);
+  ::close(sockfd);
+}
+
+// 线程池中的loop使用默认的poller，通过环境变量选择
+void run(const char *poller, bool completion_mode, bool edge_triggered, uint16_t port) {
+  ServerFixture    fixture(poller, port, "echo");
+  TcpServer       &server = fixture.server();
+  EventLoop       &loop = *fixture.loop();
+  std::atomic<int> up{0};
+  std::atomic<int> down{0};
+  std::atomic<int> completion_conns{0};
+  std::atomic<int> edge_triggered_conns{0};
+  server.set_thread_num(2);
+  server.set_completion_mode(completion_mode);
+  server.set_edge_triggered(edge_triggered);
+  server.set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+    if (conn->connected()) {
+      ++up;
+      if (conn->completion_mode()) ++completion_conns;
+      if (conn->edge_triggered()) ++edge_triggered_conns;
+    } else {
+      ++down;
+    }
+  });
+  server.set_message_callback(
+    [](const std::shared_ptr<TcpConnection> &conn, Buffer *buf, Timestamp) { conn->send(buf); });
+
+  fixture.run([ & ] {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kConns; ++i) threads.emplace_back(echo_client, port, i);
+    for (auto &t : threads) t.join();
+    while (down != kConns) ::usleep(1000);
+  });
+
+  LOG(INFO) << "poller[" << loop.poller_name() << "], completion_mode[" << completion_mode << "], edge_triggered["
+            << edge_triggered << "], conns[" << up << "], completion_conns[" << completion_conns
+            << "], edge_triggered_conns[" << edge_triggered_conns << "]";
+  assert(up == kConns && down == kConns);
+  // 子线程的loop和主loop使用同样的poller，完成模式只在io_uring下生效
+  if (!completion_mode || std::string(loop.poller_name()) != "io_uring") {
+    assert(completion_conns == 0);
+  } else {
+    assert(completion_conns == kConns);
+  }
+  // 边沿触发只有epoll支持
+  if (edge_triggered && std::string(loop.poller_name()) == "epoll") {
+    assert(edge_triggered_conns == kConns);
+  } else {
+    assert(edge_triggered_conns == 0);
+  }
+}
+
+// 边沿触发的连接每次回调都stop_read，再在同一轮的pending functors中start_read，最终关注的事件没有变化，
+// epoll_ctl(MOD)仍然要提交，内核重新检查socket中剩下的数据，否则不会再有新的边沿通知，客户端永远收不到回显
+void check_edge_triggered_rearm(uint16_t port) {
+  ServerFixture    fixture("epoll", port, "rearm");
+  TcpServer       &server = fixture.server();
+  std::atomic<int> pauses{0};
+  std::atomic<int> down{0};
+  server.set_edge_triggered(true);
+  server.set_connection_callback([ & ](const std::shared_ptr<TcpConnection> &conn) {
+    if (conn->connected()) {
+      assert(conn->edge_triggered());
+    } else {
+      ++down;
+    }
+  });
+  server.set_message_callback([ & ](const std::shared_ptr<TcpConnection> &conn, Buffer *buf, Timestamp) {
+    conn->send(buf);
+    conn->stop_read();
+    conn->get_loop()->queue_in_loop([ conn ] { conn->start_read(); });
+    ++pauses;
+  });
+
+  fixture.run([ & ] {
+    int sockfd = connect_to(port);
+    // 丢失通知时read超时返回-1
+    struct timeval timeout = {5, 0};
+    ::setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    const size_t kRearmBytes = 4 * kBytes;
+    std::string  message(kRearmBytes, 'r');
+    std::thread  writer([ sockfd, &message ] { write_all(sockfd, message); });
+    std::string  received = read_exactly(sockfd, kRearmBytes);
+    assert(received == message);
+    writer.join();
+    ::close(sockfd);
+    while (down != 1) ::usleep(1000);
+  });
+  LOG(INFO) << "edge triggered rearm ok, pauses[" << pauses << "]";
+  assert(pauses > 1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  run("epoll", false, false, 19981);
+  run("epoll", true, false, 19982);
+  run("io_uring", false, false, 19983);
+  run("io_uring", true, false, 19984);
+  run("epoll", false, true, 19985);
+  run("io_uring", false, true, 19986);
+  check_edge_triggered_rearm(19987);
+}
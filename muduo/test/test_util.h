@@ -0,0 +1,104 @@
+#pragma once
+
+// 测试共用的回环连接、消息生成和TcpServer的运行框架
+// 只有头文件：test目录下的每个.cc都会被aux_source_directory编译成一个测试程序
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/noncopyable.hpp>
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/inet_address.h"
+#include "muduo/src/tcpserver.h"
+
+namespace muduo {
+namespace test {
+
+// 阻塞地连接127.0.0.1:port
+inline int connect_to(uint16_t port) {
+  int                sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0x00, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int ret = ::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof addr);
+  assert(ret == 0);
+  (void)ret;
+  return sockfd;
+}
+
+// 长度为len的可读内容，seed不同的消息内容错开，用来发现错位和串到其他连接的数据
+inline std::string make_message(size_t len, int seed) {
+  std::string message(len, '\0');
+  for (size_t i = 0; i < len; ++i) message[ i ] = static_cast<char>('a' + (i + seed) % 26);
+  return message;
+}
+
+// 阻塞地写完message，每次最多写max_write字节
+inline void write_all(int sockfd, const std::string &message, size_t max_write = std::string::npos) {
+  size_t sent = 0;
+  while (sent < message.size()) {
+    ssize_t n = ::write(sockfd, message.data() + sent, std::min(max_write, message.size() - sent));
+    assert(n > 0);
+    sent += n;
+  }
+}
+
+// 阻塞地读到len字节，连接不能提前关闭
+inline std::string read_exactly(int sockfd, size_t len) {
+  std::string received;
+  char        buf[ 65536 ];
+  while (received.size() < len) {
+    ssize_t n = ::read(sockfd, buf, std::min(sizeof buf, len - received.size()));
+    assert(n > 0);
+    received.append(buf, n);
+  }
+  return received;
+}
+
+// 在当前线程中运行一个只监听回环地址的TcpServer，客户端在另一个线程中执行：
+// poller不为空时先设置MUDUO_POLLER，之后构造的loop(包括线程池中的)都使用它；
+// 构造之后通过server()配置，run()启动server，client返回之后退出loop，client线程结束之后返回
+class ServerFixture : public boost::noncopyable {
+public:
+  ServerFixture(const char *poller, uint16_t port, const std::string &name)
+      : _poller(set_poller(poller))
+      , _server(&_loop, InetAddress(port, true), name) {}
+
+  EventLoop *loop() { return &_loop; }
+  TcpServer &server() { return _server; }
+
+  void run(const std::function<void()> &client) {
+    _server.start();
+    std::thread thread([ this, &client ] {
+      client();
+      _loop.queue_in_loop([ this ] { _loop.quit(); });
+    });
+    _loop.loop();
+    thread.join();
+  }
+
+private:
+  static const char *set_poller(const char *poller) {
+    if (poller != nullptr) ::setenv("MUDUO_POLLER", poller, 1);
+    return poller;
+  }
+
+  const char *_poller; // 必须在_loop之前初始化
+  EventLoop   _loop;
+  TcpServer   _server;
+};
+
+} // namespace test
+} // namespace muduo
@@ -0,0 +1,89 @@
+#include <glog/logging.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/timestamp.h"
+
+using namespace muduo;
+
+namespace {
+
+const int    kRounds = 200;
+const double kDelay = 0.0002; // 200us，比原来reset_timerfd的100us下限和epoll_wait的1ms精度都要细
+
+// 定时器用poll超时触发(或者timerfd)时的精度
+void check_precision(PollerBackend backend, const char *timer_mode) {
+  ::setenv("MUDUO_TIMER", timer_mode, 1);
+  EventLoop loop(backend);
+  LOG(INFO) << "poller[" << loop.poller_name() << "], uses_timerfd[" << loop.uses_timerfd() << "]";
+  if (std::string(timer_mode) == "timerfd") {
+    assert(loop.uses_timerfd());
+  }
+
+  // 一个接一个的短定时器，记录每次触发比预期晚了多少
+  int       fired = 0;
+  int64_t   total_late_us = 0;
+  int64_t   max_late_us = 0;
+  Timestamp expected;
+  std::function<void()> schedule = [ & ] {
+    expected = Timestamp::now() + kDelay;
+    loop.run_after(kDelay, [ & ] {
+      int64_t late = Timestamp::now() - expected;
+      assert(late >= 0);
+      total_late_us += late;
+      max_late_us = std::max(max_late_us, late);
+      if (++fired < kRounds) {
+        schedule();
+      } else {
+        loop.quit();
+      }
+    });
+  };
+  schedule();
+  loop.loop();
+  LOG(INFO) << "timers fired[" << fired << "], avg late[" << total_late_us / fired << "us], max late[" << max_late_us
+            << "us]";
+  assert(fired == kRounds);
+  // 平均延迟在毫秒以下，机器很忙时允许偶尔的长尾
+  assert(total_late_us / fired < 1000);
+}
+
+// loop上没有定时器时poll一直等待，其他线程添加的定时器通过wakeup让loop重新计算超时
+void check_cross_thread(PollerBackend backend, const char *timer_mode) {
+  ::setenv("MUDUO_TIMER", timer_mode, 1);
+  EventLoop   loop(backend);
+  Timestamp   start = Timestamp::now();
+  bool        done = false;
+  std::thread thread([ & ] {
+    ::usleep(20 * 1000);
+    loop.run_after(0.01, [ & ] {
+      done = true;
+      loop.quit();
+    });
+  });
+  loop.loop();
+  thread.join();
+  assert(done);
+  int64_t elapsed_us = Timestamp::now() - start;
+  LOG(INFO) << "cross-thread timer fired after " << elapsed_us << "us";
+  assert(elapsed_us >= 30 * 1000);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  for (PollerBackend backend : {PollerBackend::kEpoll, PollerBackend::kIoUring}) {
+    for (const char *timer_mode : {"poll", "timerfd"}) {
+      check_precision(backend, timer_mode);
+      check_cross_thread(backend, timer_mode);
+    }
+  }
+}
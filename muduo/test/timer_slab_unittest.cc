@@ -0,0 +1,100 @@
+#include <glog/logging.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/timer_slab.h"
+
+using namespace muduo;
+
+namespace {
+
+// 槽被回收后generation改变，旧的TimerId找不到新的定时器
+void check_slab() {
+  TimerSlab slab;
+  assert(slab.find(TimerId()) == nullptr);
+  TimerId first = slab.allocate();
+  Timer  *timer = slab.construct(first, [] {}, Timestamp::now(), 0.0);
+  assert(slab.find(first) == timer);
+  slab.destroy(timer);
+  assert(slab.find(first) == nullptr);
+
+  TimerId second = slab.allocate();
+  assert(second.index() == first.index() && second.generation() != first.generation());
+  slab.construct(second, [] {}, Timestamp::now(), 0.0);
+  assert(slab.find(first) == nullptr);
+  assert(slab.find(second) != nullptr);
+  // 超出已分配范围的下标
+  assert(slab.find(TimerId(1 << 30, 1)) == nullptr);
+  // second由slab析构
+}
+
+// 到期的定时器的id失效之后，取消旧的id不影响新的定时器(包括复用了同一个槽的定时器)。
+// first的回调返回之后它的槽才被回收，在pending functor中再添加新的定时器；
+// 空闲的槽可能先被refill_remote拿走，所以不要求一定复用同一个槽
+void check_stale_cancel(const char *queue) {
+  ::setenv("MUDUO_TIMER_QUEUE", queue, 1);
+  EventLoop loop;
+  bool      fired = false;
+  TimerId   first;
+  first = loop.run_after(0.001, [ & ] {
+    loop.queue_in_loop([ & ] {
+      TimerId second = loop.run_after(0.001, [ & ] {
+        fired = true;
+        loop.quit();
+      });
+      if (second.index() == first.index()) assert(second.generation() != first.generation());
+      loop.cancel(first);
+      loop.cancel(first);
+      assert(loop.timer_count() == 1);
+    });
+  });
+  loop.loop();
+  assert(fired);
+}
+
+// 多个线程同时添加和取消定时器，在回调之前就被取消的定时器不会执行
+void check_cross_thread(const char *queue) {
+  ::setenv("MUDUO_TIMER_QUEUE", queue, 1);
+  const int        kThreads = 4;
+  const int        kTimers = 20000;
+  EventLoop        loop;
+  std::atomic<int> fired{0};
+  std::atomic<int> done{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([ & ] {
+      std::vector<TimerId> ids;
+      for (int i = 0; i < kTimers; ++i) {
+        ids.push_back(loop.run_after(0.05 + 0.001 * (i % 50), [ & ] { ++fired; }));
+      }
+      for (int i = 0; i < kTimers; i += 2) {
+        loop.cancel(ids[ i ]);
+      }
+      ++done;
+    });
+  }
+  for (auto &t : threads) t.join();
+  loop.run_after(0.5, [ & ] { loop.quit(); });
+  loop.loop();
+  LOG(INFO) << "queue[" << loop.timer_queue_name() << "], fired[" << fired << "]";
+  assert(done == kThreads);
+  assert(fired == kThreads * kTimers / 2);
+  assert(loop.timer_count() == 0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_slab();
+  for (const char *queue : {"set", "wheel"}) {
+    check_stale_cancel(queue);
+    check_cross_thread(queue);
+  }
+}
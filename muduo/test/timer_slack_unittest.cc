@@ -0,0 +1,74 @@
+#include <glog/logging.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "muduo/src/event_loop.h"
+
+using namespace muduo;
+
+namespace {
+
+const int    kTimers = 20;
+const double kSlack = 0.05;
+
+// 到期时间相隔1ms的定时器，允许晚50ms执行时合并成一两次唤醒，并且都不会在到期之前执行
+void check_coalescing(const char *queue, const char *timer_mode, double slack) {
+  ::setenv("MUDUO_TIMER_QUEUE", queue, 1);
+  ::setenv("MUDUO_TIMER", timer_mode, 1);
+  EventLoop loop;
+  int       fired = 0;
+  Timestamp start = Timestamp::now();
+  for (int i = 0; i < kTimers; ++i) {
+    double    delay = 0.01 + 0.001 * i;
+    Timestamp expiration = start + delay;
+    loop.run_at(expiration, slack, [ &, expiration ] {
+      Timestamp now = Timestamp::now();
+      // 不会提前执行；最晚什么时候执行取决于调度，不检查上限
+      assert(!(now < expiration));
+      if (++fired == kTimers) loop.quit();
+    });
+  }
+  loop.loop();
+  LOG(INFO) << "queue[" << loop.timer_queue_name() << "], uses_timerfd[" << loop.uses_timerfd() << "], slack["
+            << slack << "], timer wakeups[" << loop.timer_wakeups() << "], saved[" << loop.saved_timer_wakeups()
+            << "]";
+  assert(fired == kTimers);
+  assert(loop.timer_wakeups() + loop.saved_timer_wakeups() <= kTimers);
+  if (slack > 0) {
+    assert(loop.timer_wakeups() <= 3);
+    assert(loop.saved_timer_wakeups() >= kTimers - 3);
+  } else {
+    assert(loop.saved_timer_wakeups() == 0);
+  }
+}
+
+// 有slack的run_every仍然按间隔重复执行，可以被取消
+void check_every(const char *queue) {
+  ::setenv("MUDUO_TIMER_QUEUE", queue, 1);
+  EventLoop loop;
+  int       ticks = 0;
+  TimerId   heartbeat;
+  heartbeat = loop.run_every(0.005, 0.005, [ & ] {
+    if (++ticks == 10) {
+      loop.cancel(heartbeat);
+      loop.run_after(0.05, [ & ] { loop.quit(); });
+    }
+  });
+  loop.loop();
+  assert(ticks == 10);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  for (const char *queue : {"set", "wheel"}) {
+    for (const char *timer_mode : {"poll", "timerfd"}) {
+      check_coalescing(queue, timer_mode, kSlack);
+      check_coalescing(queue, timer_mode, 0.0);
+    }
+    check_every(queue);
+  }
+}
@@ -0,0 +1,197 @@
+#include <glog/logging.h>
+#include <stdlib.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "muduo/src/event_loop.h"
+#include "muduo/src/timer.h"
+#include "muduo/src/timer_queue.h"
+#include "muduo/src/timing_wheel.h"
+
+using namespace muduo;
+
+namespace {
+
+const int64_t kTickUs = 1000;
+
+// 随机的添加、删除和推进时间，和按到期时间排序的std::map对照：
+// 每个定时器不早于到期时间、最多晚一个tick取出，next_expiration不晚于最早的定时器所在的tick
+void check_against_map() {
+  std::mt19937_64 rng(20240601);
+  Timestamp       origin = Timestamp::now();
+  TimingWheel     wheel(origin, kTickUs);
+  // 覆盖各层：从不到一个tick到几天
+  std::vector<int64_t> spans = {500, 50 * 1000, 5 * 1000 * 1000, 600LL * 1000 * 1000, 3 * 86400LL * 1000 * 1000};
+  std::multimap<Timestamp, Timer *>   pending;
+  std::vector<std::unique_ptr<Timer>> timers;
+  std::vector<Timer *>                expired;
+  Timestamp                           now = origin;
+  int64_t                             fired = 0;
+  int64_t                             removed = 0;
+
+  for (int round = 0; round < 20000; ++round) {
+    int op = static_cast<int>(rng() % 10);
+    if (op < 5) {
+      int64_t   span = spans[ rng() % spans.size() ];
+      Timestamp when(now.ms_since_epoch() + rng() % span);
+      timers.emplace_back(new Timer(TimerId(), [] {}, when, 0.0));
+      wheel.add(timers.back().get());
+      pending.emplace(when, timers.back().get());
+    } else if (op < 6 && !pending.empty()) {
+      auto it = pending.begin();
+      std::advance(it, rng() % pending.size());
+      wheel.remove(it->second);
+      pending.erase(it);
+      ++removed;
+    } else {
+      // 有时推进一小步，有时跳过很长一段
+      Timestamp next = wheel.next_expiration();
+      if (!pending.empty()) {
+        assert(next.valid() && next.ms_since_epoch() < pending.begin()->first.ms_since_epoch() + kTickUs);
+      } else {
+        assert(!next.valid());
+      }
+      int64_t step = (rng() % 4 == 0) ? spans[ rng() % spans.size() ] : static_cast<int64_t>(rng() % 3000);
+      now = Timestamp(now.ms_since_epoch() + step);
+      expired.clear();
+      wheel.advance(now, &expired);
+      for (Timer *timer : expired) {
+        assert(!(now < timer->expiration()));
+        auto range = pending.equal_range(timer->expiration());
+        auto it = range.first;
+        while (it != range.second && it->second != timer) ++it;
+        assert(it != range.second);
+        pending.erase(it);
+        ++fired;
+      }
+      // 所有早于now一个tick以上的定时器都已经取出
+      assert(pending.empty() || now.ms_since_epoch() < pending.begin()->first.ms_since_epoch() + kTickUs);
+    }
+    assert(wheel.size() == pending.size());
+  }
+  LOG(INFO) << "timers[" << timers.size() << "], fired[" << fired << "], removed[" << removed << "], left["
+            << wheel.size() << "]";
+}
+
+Timestamp add_us(Timestamp t, int64_t us) { return Timestamp(t.ms_since_epoch() + us); }
+
+// 有slack的定时器对齐到窗口中的某个tick，但不能越出窗口：
+// 推进到到期时间前一个tick时没有触发，推进到deadline前一个tick时可以触发也可以不触发，推进到deadline时一定已经触发。
+// 窗口里要有tick的边界，否则只能晚一个tick触发：slack至少一个tick，没有slack的到期时间对齐到tick
+void check_slack_window() {
+  std::mt19937_64 rng(20240607);
+  Timestamp       origin = Timestamp::now();
+  for (int i = 0; i < 5000; ++i) {
+    TimingWheel wheel(origin, kTickUs);
+    int64_t     expire_us = 2 * kTickUs + static_cast<int64_t>(rng() % (5000 * kTickUs));
+    int64_t     slack_us = (i % 5 == 0) ? 0 : kTickUs + static_cast<int64_t>(rng() % (300 * kTickUs));
+    if (slack_us == 0) expire_us -= expire_us % kTickUs;
+    Timer       timer(TimerId(), [] {}, add_us(origin, expire_us), 0.0, slack_us);
+    wheel.add(&timer);
+
+    std::vector<Timer *> expired;
+    wheel.advance(add_us(timer.expiration(), -kTickUs), &expired);
+    assert(expired.empty());
+    wheel.advance(add_us(timer.deadline(), -kTickUs), &expired);
+    assert(expired.empty() || slack_us >= kTickUs);
+    wheel.advance(timer.deadline(), &expired);
+    assert(expired.size() == 1 && expired[ 0 ] == &timer);
+    assert(wheel.empty());
+  }
+}
+
+// 同一个TimerQueue中许多窗口互相重叠的定时器，以不规则的步长推进时间，每一步检查：
+// 触发的定时器都已经到了到期时间，deadline已过的定时器都已经触发。
+// 时间轮的起点由TimerQueue决定，没有slack的定时器不一定对齐到tick，允许晚一个tick。
+// set按deadline排序，同一批取出的定时器deadline不减
+void check_timer_queue_window(bool use_wheel) {
+  std::mt19937_64 rng(20240608);
+  EventLoop       loop;
+  TimerQueue      queue(&loop, false, use_wheel);
+  Timestamp       base = Timestamp::now();
+
+  struct Window {
+    Timestamp expiration;
+    Timestamp deadline;
+    Timestamp latest; // 最晚的触发时间
+    Timestamp fired;
+  };
+  const int           kTimers = 2000;
+  std::vector<Window> windows(kTimers);
+  std::vector<int>    batch;
+  for (int i = 0; i < kTimers; ++i) {
+    int64_t expire_us = kTickUs + static_cast<int64_t>(rng() % (2000 * kTickUs));
+    int64_t slack_us = (i % 5 == 0) ? 0 : kTickUs + static_cast<int64_t>(rng() % (100 * kTickUs));
+    windows[ i ].expiration = add_us(base, expire_us);
+    windows[ i ].deadline = add_us(base, expire_us + slack_us);
+    windows[ i ].latest = (use_wheel && slack_us == 0) ? add_us(windows[ i ].deadline, kTickUs) : windows[ i ].deadline;
+    queue.add_timer(windows[ i ].expiration, 0.0, [ &batch, i ] { batch.push_back(i); },
+                    static_cast<double>(slack_us) / Timestamp::kMicroSecondsPerSecond);
+  }
+  assert(queue.size() == kTimers);
+
+  int       fired = 0;
+  Timestamp now = base;
+  while (fired < kTimers) {
+    now = add_us(now, 1 + static_cast<int64_t>(rng() % (2 * kTickUs)));
+    batch.clear();
+    queue.handle_expired(now);
+    for (size_t j = 0; j < batch.size(); ++j) {
+      Window &w = windows[ batch[ j ] ];
+      assert(!w.fired.valid());
+      assert(!(now < w.expiration));
+      if (!use_wheel && j > 0) assert(!(w.deadline < windows[ batch[ j - 1 ] ].deadline));
+      w.fired = now;
+    }
+    fired += static_cast<int>(batch.size());
+    for (const Window &w : windows) assert(w.fired.valid() || now < w.latest);
+  }
+  assert(queue.size() == 0);
+  LOG(INFO) << queue.name() << ": wakeups[" << queue.wakeups() << "], saved[" << queue.saved_wakeups() << "]";
+}
+
+// EventLoop用时间轮时run_after/run_every/cancel的语义不变
+void check_event_loop() {
+  ::setenv("MUDUO_TIMER_QUEUE", "wheel", 1);
+  EventLoop loop;
+  assert(std::string(loop.timer_queue_name()) == "wheel");
+
+  Timestamp start = Timestamp::now();
+  int       every = 0;
+  bool      cancelled_fired = false;
+  TimerId   cancelled = loop.run_after(0.2, [ & ] { cancelled_fired = true; });
+  TimerId   ticker;
+  ticker = loop.run_every(0.005, [ & ] {
+    if (++every == 5) loop.cancel(ticker); // 在自己的回调中取消
+  });
+  loop.run_after(0.01, [ & ] { loop.cancel(cancelled); });
+  // 一个远在几天之后的定时器，退出时由TimerQueue释放
+  loop.run_after(3 * 86400.0, [] { assert(false); });
+  // 取消和被取消的定时器在同一轮到期时，被取消的仍然会执行，所以两者相隔远一些
+  loop.run_after(0.3, [ & ] {
+    int64_t elapsed_us = Timestamp::now() - start;
+    assert(elapsed_us >= 300 * 1000);
+    loop.quit();
+  });
+  loop.loop();
+  LOG(INFO) << "run_every fired " << every << " times, timers left " << loop.timer_count();
+  assert(every == 5);
+  assert(!cancelled_fired);
+  assert(loop.timer_count() == 1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  check_against_map();
+  check_slack_window();
+  check_timer_queue_window(false);
+  check_timer_queue_window(true);
+  check_event_loop();
+}
@@ -0,0 +1,44 @@
+
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "muduo/src/current_thread.h"
+#include "muduo/src/event_loop.h"
+#include "muduo/src/event_loop_thread.h"
+
+using namespace muduo;
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  const int kProducers = 4;
+  const int kTasks = 100000;
+
+  EventLoopThread  loop_thread(EventLoopThread::ThreadInitCallback(), "wakeup_coalescing");
+  auto            *loop = loop_thread.start_loop();
+  std::atomic<int> done{0};
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([ loop, &done ] {
+      for (int i = 0; i < kTasks; ++i) {
+        loop->queue_in_loop([ &done ] { ++done; });
+      }
+    });
+  }
+  for (auto &t : producers) {
+    t.join();
+  }
+  while (done != kProducers * kTasks) {
+    ::usleep(1000);
+  }
+
+  // 每个任务都写一次eventfd的话，wakeup_count应该等于任务数
+  LOG(INFO) << "tasks[" << kProducers * kTasks << "], wakeups[" << loop->wakeup_count() << "], suppressed["
+            << loop->suppressed_wakeup_count() << "]";
+  assert(loop->wakeup_count() + loop->suppressed_wakeup_count() == kProducers * kTasks);
+}